@@ -106,8 +106,6 @@ long ImageRepresentation::getSqSum(Rect imageROI)
 	int OriginX = imageROI.left-m_offset.col;
 	int OriginY = imageROI.upper-m_offset.row;
 
-        __uint64 *OriginPtr = &intSqImage[OriginY * (m_ROI.width+1) + OriginX];
-
 	// Check and fix width and height
 	int Width  = imageROI.width;
 	int Height = imageROI.height;
@@ -115,14 +113,10 @@ long ImageRepresentation::getSqSum(Rect imageROI)
 	if ( OriginX+Width  >= m_ROI.width  ) Width  = m_ROI.width  - OriginX;
 	if ( OriginY+Height >= m_ROI.height ) Height = m_ROI.height  - OriginY;
 
-	unsigned long down  = Height * (m_ROI.width+1);
-	unsigned long right = Width;
-
-	__int64 value = OriginPtr[down+right] + OriginPtr[0] - OriginPtr[right] - OriginPtr[down];
+	__int64 value = haar::rect_sum(intSqImage, m_ROI.width+1, OriginX, OriginY, Width, Height);
 
 	assert (value >= 0);
 
-	OriginPtr = NULL;
 	return value;
 
 }
@@ -147,8 +141,6 @@ __int32 ImageRepresentation::getSum(Rect imageROI)
 	int OriginX = imageROI.left-m_offset.col;
 	int OriginY = imageROI.upper-m_offset.row;
 
-        __uint32 *OriginPtr = &intImage[OriginY * (m_ROI.width+1) + OriginX];
-
 	// Check and fix width and height
 	int Width  = imageROI.width;
 	int Height = imageROI.height;
@@ -156,13 +148,8 @@ __int32 ImageRepresentation::getSum(Rect imageROI)
 	if ( OriginX+Width  >= m_ROI.width  ) Width  = m_ROI.width  - OriginX;
 	if ( OriginY+Height >= m_ROI.height ) Height = m_ROI.height  - OriginY;
 
-	unsigned long down  = Height * (m_ROI.width+1);
-	unsigned long right = Width;
-
-	__int32 value = OriginPtr[down+right] + OriginPtr[0] - OriginPtr[right] - OriginPtr[down];
-
+	__int32 value = haar::rect_sum(intImage, m_ROI.width+1, OriginX, OriginY, Width, Height);
 
-	OriginPtr = NULL;
 	return value;
 }
 
@@ -184,48 +171,6 @@ float ImageRepresentation::getMean(Rect imageROI)
 
 void ImageRepresentation::createIntegralsOfROI(unsigned char* image)
 {
-	unsigned long ROIlength = (m_ROI.width+1)*(m_ROI.height+1);
-	int columnidx, rowidx;
-	unsigned long curPointer;
-	unsigned long dptr;
-
-
-	curPointer = 0;
-	dptr = 0;
-
-	memset(intImage, 0x00, ROIlength * sizeof( unsigned int ) );
-	memset(intSqImage, 0x00, ROIlength * sizeof( unsigned __int64 ) ); 
-
-	// current sum
-	unsigned int value_tmp = 0;
-	unsigned int value_tmpSq = 0;
-
-	for (rowidx = 0; rowidx<m_ROI.height; rowidx++)
-	{
-		// current Image Position
-		curPointer = (rowidx+m_ROI.upper)*m_imageSize.width+m_ROI.left;
-
-		// current Integral Image Position
-		dptr = (m_ROI.width+1)*(rowidx+1) + 1;
-
-		value_tmp = 0;
-		value_tmpSq = 0;
-
-		for (columnidx = 0; columnidx<m_ROI.width; columnidx++)
-		{
-			// cumulative row sum
-			value_tmp += image[curPointer];
-			value_tmpSq += image[curPointer]*image[curPointer];
-
-			// update Integral Image
-			intImage[dptr] = intImage[ dptr - (m_ROI.width+1) ] + value_tmp;
-			intSqImage[dptr] = intSqImage[ dptr - (m_ROI.width+1) ] + value_tmpSq;
-
-			dptr++;
-			curPointer++;
-		}
-
-	}
-
-	return;
+	haar::integral(image + m_ROI.upper*m_imageSize.width + m_ROI.left, m_ROI.width, m_ROI.height, m_imageSize.width,
+		intImage, m_ROI.width+1, intSqImage, m_ROI.width+1);
 }
@@ -4,6 +4,7 @@
 #include <memory.h>
 #include <math.h>
 #include "Regions.h"
+#include "haar_features.h"
 
 class ImageRepresentation  
 {
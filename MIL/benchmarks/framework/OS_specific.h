@@ -0,0 +1,4 @@
+// The FRAMEWORK sources include <OS_specific.h> from the FRAMEWORK root, which also holds an
+// MSVC-only stdint.h: this directory exposes the one header without putting that root on
+// the include path.
+#include "../../../BoostingTracker/FRAMEWORK/OS_specific.h"
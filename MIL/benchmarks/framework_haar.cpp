@@ -0,0 +1,72 @@
+#include <vector>
+
+#include "FeatureHaar.h"
+#include "ImageRepresentation.h"
+#include "framework_haar.h"
+
+namespace framework_haar
+{
+  struct Kernel
+  {
+    ImageRepresentation* image;
+    std::vector<FeatureHaar*> features;
+    int patch_width, patch_height;
+  };
+
+  Kernel*
+  create(int width, int height, int patch_width, int patch_height, int num_features)
+  {
+    Kernel* kernel = new Kernel;
+    kernel->image = new ImageRepresentation(NULL, Size(height, width));
+    kernel->patch_width = patch_width;
+    kernel->patch_height = patch_height;
+    for (int i = 0; i < num_features; i++)
+    {
+      kernel->features.push_back(new FeatureHaar(Size(patch_height, patch_width)));
+    }
+    return kernel;
+  }
+
+  void
+  release(Kernel* kernel)
+  {
+    for (size_t i = 0; i < kernel->features.size(); i++)
+    {
+      delete kernel->features[i];
+    }
+    delete kernel->image;
+    delete kernel;
+  }
+
+  void
+  integral(Kernel* kernel, unsigned char* image)
+  {
+    kernel->image->setNewImage(image);
+  }
+
+  int
+  num_rects(const Kernel* kernel)
+  {
+    int rects = 0;
+    for (size_t i = 0; i < kernel->features.size(); i++)
+    {
+      rects += kernel->features[i]->getNumAreas();
+    }
+    return rects;
+  }
+
+  void
+  eval(Kernel* kernel, const int* xy, int num_samples, float* values)
+  {
+    int num_features = (int) kernel->features.size();
+    for (int f = 0; f < num_features; f++)
+    {
+      FeatureHaar* feature = kernel->features[f];
+      for (int i = 0; i < num_samples; i++)
+      {
+        feature->eval(kernel->image, Rect(xy[2 * i + 1], xy[2 * i], kernel->patch_height, kernel->patch_width),
+                      &values[f * num_samples + i]);
+      }
+    }
+  }
+}
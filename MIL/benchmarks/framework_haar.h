@@ -0,0 +1,33 @@
+// The FRAMEWORK boosting Haar features (BoostingTracker/FRAMEWORK/OnlineBoosting) behind a plain
+// interface: the FRAMEWORK declares its own global Rect, Size and Point2D, so it is compiled in a
+// translation unit of its own.
+
+#ifndef __FRAMEWORK_HAAR_H__
+#define __FRAMEWORK_HAAR_H__
+
+namespace framework_haar
+{
+  struct Kernel;
+
+  // An image representation of width x height and num_features random features of a patch_width x patch_height patch
+  Kernel*
+  create(int width, int height, int patch_width, int patch_height, int num_features);
+
+  void
+  release(Kernel* kernel);
+
+  // Integral and squared integral images of an 8-bit gray image of the kernel size
+  void
+  integral(Kernel* kernel, unsigned char* image);
+
+  // Total number of rectangles of the features
+  int
+  num_rects(const Kernel* kernel);
+
+  // values (num_features x num_samples) of the features at the patches whose upper left corners are
+  // (xy[2 * i], xy[2 * i + 1])
+  void
+  eval(Kernel* kernel, const int* xy, int num_samples, float* values);
+}
+
+#endif  // #ifndef __FRAMEWORK_HAAR_H__
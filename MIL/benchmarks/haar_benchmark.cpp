@@ -0,0 +1,723 @@
+// Micro-benchmarks of the integral image and Haar feature kernels of the collection:
+//
+//   ct         CompressiveTracker::getFeatureValue over cv::integral (RCT/c++)
+//   mil        cv::mil::Ftr::compute over compute_integral: haar::integral_channels and the batched
+//              haar::FeatureTable::evaluate over a SampleSet, as the MIL classifiers call it
+//   mil-virtual  the virtual per-sample HaarFtr::compute over the same integral (the old MIL path)
+//   boosting   cv::boosting::FeatureHaar::eval / ImageRepresentation::getSum (MIL's port of the FRAMEWORK)
+//   framework  FeatureHaar::eval / ImageRepresentation::getSum (BoostingTracker/FRAMEWORK)
+//   rct-mex    getFtrVal / integral of the RCT MEX files (RCT/matlab/core)
+//
+// All of them run on the same random 8-bit image and sample positions.  ct, the mil kernels and rct-mex
+// evaluate the same random rectangle table (2 to 6 weighted rectangles per feature, as CT and
+// MIL draw them); the boosting kernels only evaluate the Haar types they generate themselves,
+// so compare them per rectangle.  Values are checked against ct where the table is shared.
+//
+// Each kernel is repeated for at least -t seconds.  The integral is reported in ns/pixel, the
+// features in ns/feature (one feature on one sample) and ns/rect, with cycles, instructions
+// and cache misses per feature from the hardware counters when perf_event_open is available.
+//
+//   HaarBenchmark [-w width] [-h height] [-p patch_width,patch_height] [-f features] [-s samples]
+//                 [-r min_rects,max_rects] [-t seconds] [-o results.json]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cv_onlinemil.h>
+#include <cv_onlineboosting.h>
+#include <CompressiveTracker.h>
+#include <haar_core.h>
+
+#include "framework_haar.h"
+
+//
+// Hardware counters
+//
+
+enum
+{
+  CYCLES = 0, INSTRUCTIONS, CACHE_MISSES, L1D_MISSES, NUM_COUNTERS
+};
+
+static const char* counter_names[NUM_COUNTERS] = { "cycles", "instructions", "cache_misses", "l1d_misses" };
+
+// A group of counters of this thread, user space only
+class PerfCounters
+{
+public:
+  PerfCounters()
+  {
+    for (int i = 0; i < NUM_COUNTERS; i++)
+    {
+      fd_[i] = -1;
+    }
+#ifdef __linux__
+    const unsigned int types[NUM_COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                               PERF_TYPE_HW_CACHE };
+    const unsigned long long configs[NUM_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                       PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_CACHE_L1D
+                                                           | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                                           | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) };
+    for (int i = 0; i < NUM_COUNTERS; i++)
+    {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = types[i];
+      attr.config = configs[i];
+      attr.disabled = (i == 0);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      fd_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fd_[0], 0);
+      if (fd_[i] < 0 && i == 0)
+      {
+        return;
+      }
+    }
+#endif
+  }
+
+  ~PerfCounters()
+  {
+#ifdef __linux__
+    for (int i = NUM_COUNTERS - 1; i >= 0; i--)
+    {
+      if (fd_[i] >= 0)
+      {
+        close(fd_[i]);
+      }
+    }
+#endif
+  }
+
+  bool
+  available() const
+  {
+    return fd_[0] >= 0;
+  }
+
+  bool
+  available(int counter) const
+  {
+    return fd_[counter] >= 0;
+  }
+
+  void
+  start()
+  {
+#ifdef __linux__
+    if (available())
+    {
+      ioctl(fd_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fd_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+  }
+
+  // Counts since start(), in the order of the counter enum (0 when unavailable)
+  void
+  stop(unsigned long long counts[NUM_COUNTERS])
+  {
+    for (int i = 0; i < NUM_COUNTERS; i++)
+    {
+      counts[i] = 0;
+    }
+#ifdef __linux__
+    if (!available())
+    {
+      return;
+    }
+    ioctl(fd_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    unsigned long long values[1 + NUM_COUNTERS];
+    if (read(fd_[0], values, sizeof(values)) <= 0)
+    {
+      return;
+    }
+    // values[0] is the number of counters of the group, which skips the ones that failed to open
+    int k = 1;
+    for (int i = 0; i < NUM_COUNTERS && k <= (int) values[0]; i++)
+    {
+      if (fd_[i] >= 0)
+      {
+        counts[i] = values[k++];
+      }
+    }
+#endif
+  }
+
+private:
+  int fd_[NUM_COUNTERS];
+};
+
+//
+// Measurements
+//
+
+struct Measure
+{
+  double ns;                               // per repetition
+  double counts[NUM_COUNTERS];             // per repetition
+  int repetitions;
+};
+
+// Repeats fn until min_seconds have passed (at least twice)
+template<class F>
+  Measure
+  measure(F fn, double min_seconds, PerfCounters& counters)
+  {
+    fn(); // warm up
+
+    Measure m;
+    unsigned long long counts[NUM_COUNTERS];
+    int repetitions = 1;
+    while (true)
+    {
+      counters.start();
+      int64 start = cv::getTickCount();
+      for (int r = 0; r < repetitions; r++)
+      {
+        fn();
+      }
+      double seconds = ((double) cv::getTickCount() - start) / cv::getTickFrequency();
+      counters.stop(counts);
+      if (seconds >= min_seconds || repetitions >= (1 << 24))
+      {
+        m.ns = seconds * 1e9 / repetitions;
+        for (int i = 0; i < NUM_COUNTERS; i++)
+        {
+          m.counts[i] = (double) counts[i] / repetitions;
+        }
+        m.repetitions = repetitions;
+        return m;
+      }
+      repetitions = seconds > 0 ? std::max(repetitions * 2, (int) (repetitions * 1.2 * min_seconds / seconds))
+                                : repetitions * 2;
+    }
+  }
+
+struct KernelResult
+{
+  std::string name;
+  Measure integral;
+  Measure features;
+  double pixels;
+  double evaluations;  // features x samples
+  double rects;        // rectangles summed by one pass over the samples
+  double max_error;    // against ct, -1 if not comparable
+};
+
+//
+// The shared workload
+//
+
+struct Workload
+{
+  int width, height;
+  int patch_width, patch_height;
+  int num_features, num_samples;
+  int min_rects, max_rects;
+  cv::Mat image;                           // 8-bit gray
+  std::vector<std::vector<cv::Rect> > rects;
+  std::vector<std::vector<float> > weights;
+  std::vector<cv::Rect> samples;           // patches, at least 1 pixel from the top and left border
+};
+
+static void
+make_workload(Workload & w)
+{
+  cv::RNG rng(12345);
+  w.image.create(w.height, w.width, CV_8UC1);
+  rng.fill(w.image, cv::RNG::UNIFORM, 0, 256);
+
+  // Rectangles drawn like HaarFtr::generate / CompressiveTracker::HaarFeature
+  w.rects.resize(w.num_features);
+  w.weights.resize(w.num_features);
+  for (int f = 0; f < w.num_features; f++)
+  {
+    int n = rng.uniform(w.min_rects, w.max_rects + 1);
+    for (int k = 0; k < n; k++)
+    {
+      cv::Rect r;
+      r.x = rng.uniform(0, w.patch_width - 3);
+      r.y = rng.uniform(0, w.patch_height - 3);
+      r.width = rng.uniform(1, w.patch_width - r.x - 2);
+      r.height = rng.uniform(1, w.patch_height - r.y - 2);
+      w.rects[f].push_back(r);
+      w.weights[f].push_back(rng.uniform(-1.f, 1.f));
+    }
+  }
+
+  for (int i = 0; i < w.num_samples; i++)
+  {
+    w.samples.push_back(cv::Rect(rng.uniform(1, w.width - w.patch_width), rng.uniform(1, w.height - w.patch_height),
+                                 w.patch_width, w.patch_height));
+  }
+}
+
+static double
+table_rects(const Workload & w)
+{
+  double rects = 0;
+  for (int f = 0; f < w.num_features; f++)
+  {
+    rects += w.rects[f].size();
+  }
+  return rects * w.num_samples;
+}
+
+static double
+max_error(const cv::Mat_<float> & values, const cv::Mat_<float> & reference)
+{
+  double error = 0;
+  for (int f = 0; f < reference.rows; f++)
+  {
+    for (int i = 0; i < reference.cols; i++)
+    {
+      error = std::max(error, (double) fabs(values(f, i) - reference(f, i)));
+    }
+  }
+  return error;
+}
+
+//
+// Kernels
+//
+
+static KernelResult
+run_ct(const Workload & w, double seconds, PerfCounters & counters, cv::Mat_<float> & reference)
+{
+  KernelResult result;
+  result.name = "ct";
+
+  CompressiveTracker ct;
+  ct.setFeatures(w.rects, w.weights);
+  cv::Mat image = w.image;
+  cv::Mat ii;
+  std::vector<cv::Rect> samples = w.samples;
+  cv::Mat values;
+
+  result.integral = measure([&]() { cv::integral(image, ii, CV_32F); }, seconds, counters);
+  result.features = measure([&]() { ct.getFeatureValue(ii, samples, values); }, seconds, counters);
+
+  reference = values.clone();
+  result.max_error = 0;
+  return result;
+}
+
+// MIL features over the same rectangle table
+static void
+make_mil_features(const Workload & w, std::vector<cv::mil::HaarFtr> & ftrs, cv::mil::vecFtr & ptrs)
+{
+  ftrs.resize(w.num_features);
+  ptrs.resize(w.num_features);
+  for (int f = 0; f < w.num_features; f++)
+  {
+    ftrs[f]._rects = w.rects[f];
+    ftrs[f]._weights = w.weights[f];
+    ftrs[f]._channel = 0;
+    ftrs[f]._width = w.patch_width;
+    ftrs[f]._height = w.patch_height;
+    ptrs[f] = &ftrs[f];
+  }
+}
+
+static void
+make_mil_samples(const Workload & w, const cv::mil::IntegralImage & ii, cv::mil::SampleSet & samples)
+{
+  samples.setImage(w.image, ii);
+  for (int i = 0; i < w.num_samples; i++)
+  {
+    samples.push_back(cv::mil::Sample(w.samples[i].y, w.samples[i].x, w.patch_width, w.patch_height));
+  }
+}
+
+static KernelResult
+run_mil(const Workload & w, double seconds, PerfCounters & counters, const cv::Mat_<float> & reference)
+{
+  KernelResult result;
+  result.name = "mil";
+
+  std::vector<cv::mil::HaarFtr> ftrs;
+  cv::mil::vecFtr ptrs;
+  make_mil_features(w, ftrs, ptrs);
+  cv::mil::IntegralImage ii;
+
+  result.integral = measure([&]() { compute_integral(w.image, ii); }, seconds, counters);
+
+  cv::mil::SampleSet samples;
+  make_mil_samples(w, ii, samples);
+  // resizeFtrs marks every feature as not computed, so that each repetition compiles the table and evaluates
+  // all of it, as the classifiers do on new samples
+  result.features = measure([&]()
+  {
+    samples.resizeFtrs(w.num_features);
+    cv::mil::Ftr::compute(samples, ptrs);
+  }, seconds, counters);
+
+  cv::Mat_<float> values(w.num_features, w.num_samples);
+  for (int f = 0; f < w.num_features; f++)
+  {
+    for (int i = 0; i < w.num_samples; i++)
+    {
+      values(f, i) = samples.getFtrVal(i, f);
+    }
+  }
+  result.max_error = max_error(values, reference);
+  return result;
+}
+
+static KernelResult
+run_mil_virtual(const Workload & w, double seconds, PerfCounters & counters, const cv::Mat_<float> & reference)
+{
+  KernelResult result;
+  result.name = "mil-virtual";
+
+  std::vector<cv::mil::HaarFtr> ftrs;
+  cv::mil::vecFtr ptrs;
+  make_mil_features(w, ftrs, ptrs);
+  cv::mil::IntegralImage ii;
+
+  result.integral = measure([&]() { compute_integral(w.image, ii); }, seconds, counters);
+
+  cv::mil::SampleSet samples;
+  make_mil_samples(w, ii, samples);
+  cv::Mat_<float> values(w.num_features, w.num_samples);
+  result.features = measure([&]()
+  {
+    for (int f = 0; f < w.num_features; f++)
+    {
+      for (int i = 0; i < w.num_samples; i++)
+      {
+        values(f, i) = ptrs[f]->compute(samples, i);
+      }
+    }
+  }, seconds, counters);
+
+  result.max_error = max_error(values, reference);
+  return result;
+}
+
+static KernelResult
+run_rct_mex(const Workload & w, double seconds, PerfCounters & counters, const cv::Mat_<float> & reference)
+{
+  KernelResult result;
+  result.name = "rct-mex";
+
+  // Column-major doubles, as MATLAB hands them over
+  int M = w.height, N = w.width;
+  std::vector<double> image(M * N), ii(M * N);
+  for (int y = 0; y < M; y++)
+  {
+    for (int x = 0; x < N; x++)
+    {
+      image[y + x * M] = w.image.at<uchar>(y, x);
+    }
+  }
+
+  // getFtrVal sums the rectangle (x + px .. x + px + pw - 2, y + py .. y + py + ph - 2) of a sample at
+  // (x,y) (0-based); samples are passed one pixel up and left so that px, py never end a feature at 0
+  int len_F = w.num_features, len_S = w.num_samples, len_R = w.max_rects;
+  std::vector<double> px(len_F * len_R, 0), py(len_F * len_R, 0), pw(len_F * len_R, 0), ph(len_F * len_R, 0),
+      pwt(len_F * len_R, 0);
+  for (int f = 0; f < len_F; f++)
+  {
+    for (size_t k = 0; k < w.rects[f].size(); k++)
+    {
+      px[f + k * len_F] = w.rects[f][k].x + 1;
+      py[f + k * len_F] = w.rects[f][k].y + 1;
+      pw[f + k * len_F] = w.rects[f][k].width + 1;
+      ph[f + k * len_F] = w.rects[f][k].height + 1;
+      pwt[f + k * len_F] = w.weights[f][k];
+    }
+  }
+  std::vector<double> sx(len_S), sy(len_S), values(len_F * len_S);
+  for (int i = 0; i < len_S; i++)
+  {
+    sx[i] = w.samples[i].x - 1;
+    sy[i] = w.samples[i].y - 1;
+  }
+
+  result.integral = measure([&]() { integral(&ii[0], &image[0], M, N); }, seconds, counters);
+  result.features = measure([&]()
+  {
+    getFtrVal(&values[0], &ii[0], &sx[0], &sy[0], &px[0], &py[0], &pw[0], &ph[0], &pwt[0], len_F, len_S, len_R, M, N);
+  }, seconds, counters);
+
+  // Integer accumulation: up to one unit per rectangle
+  cv::Mat_<float> v(len_F, len_S);
+  for (int f = 0; f < len_F; f++)
+  {
+    for (int i = 0; i < len_S; i++)
+    {
+      v(f, i) = (float) values[f + i * len_F];
+    }
+  }
+  result.max_error = max_error(v, reference);
+  return result;
+}
+
+static KernelResult
+run_boosting(const Workload & w, double seconds, PerfCounters & counters)
+{
+  KernelResult result;
+  result.name = "boosting";
+
+  cv::Mat image = w.image;
+  cv::Rect roi(0, 0, w.width, w.height);
+  cv::boosting::ImageRepresentation rep(image, cv::Size(w.width, w.height), roi);
+  std::vector<cv::boosting::FeatureHaar*> ftrs;
+  result.rects = 0;
+  for (int f = 0; f < w.num_features; f++)
+  {
+    ftrs.push_back(new cv::boosting::FeatureHaar(cv::Size(w.patch_width, w.patch_height)));
+    result.rects += ftrs.back()->getNumAreas();
+  }
+  result.rects *= w.num_samples;
+
+  std::vector<float> values(w.num_features * w.num_samples);
+  result.integral = measure([&]() { rep.setNewImageAndROI(image, roi); }, seconds, counters);
+  result.features = measure([&]()
+  {
+    for (int f = 0; f < w.num_features; f++)
+    {
+      for (int i = 0; i < w.num_samples; i++)
+      {
+        ftrs[f]->eval(&rep, w.samples[i], &values[f * w.num_samples + i]);
+      }
+    }
+  }, seconds, counters);
+
+  for (int f = 0; f < w.num_features; f++)
+  {
+    delete ftrs[f];
+  }
+  result.max_error = -1;
+  return result;
+}
+
+static KernelResult
+run_framework(const Workload & w, double seconds, PerfCounters & counters)
+{
+  KernelResult result;
+  result.name = "framework";
+
+  cv::Mat image = w.image.clone();
+  framework_haar::Kernel* kernel = framework_haar::create(w.width, w.height, w.patch_width, w.patch_height,
+                                                          w.num_features);
+  result.rects = (double) framework_haar::num_rects(kernel) * w.num_samples;
+  std::vector<int> xy;
+  for (int i = 0; i < w.num_samples; i++)
+  {
+    xy.push_back(w.samples[i].x);
+    xy.push_back(w.samples[i].y);
+  }
+
+  std::vector<float> values(w.num_features * w.num_samples);
+  result.integral = measure([&]() { framework_haar::integral(kernel, image.data); }, seconds, counters);
+  result.features = measure([&]() { framework_haar::eval(kernel, &xy[0], w.num_samples, &values[0]); }, seconds,
+                            counters);
+
+  framework_haar::release(kernel);
+  result.max_error = -1;
+  return result;
+}
+
+//
+// Output
+//
+
+static void
+print_result(const KernelResult & r, const PerfCounters & counters)
+{
+  printf("%-12s %10.3f %12.3f %10.3f", r.name.c_str(), r.integral.ns / r.pixels, r.features.ns / r.evaluations,
+         r.features.ns / r.rects);
+  for (int i = 0; i < NUM_COUNTERS; i++)
+  {
+    if (counters.available(i))
+      printf(" %12.2f", r.features.counts[i] / r.evaluations);
+    else
+      printf(" %12s", "n/a");
+  }
+  if (r.max_error >= 0)
+    printf(" %10.4g\n", r.max_error);
+  else
+    printf(" %10s\n", "-");
+}
+
+static void
+write_measure(std::ostream & out, const Measure & m, double units, const PerfCounters & counters)
+{
+  out << "{\"repetitions\": " << m.repetitions << ", \"ns\": " << m.ns;
+  for (int i = 0; i < NUM_COUNTERS; i++)
+  {
+    if (counters.available(i))
+      out << ", \"" << counter_names[i] << "\": " << m.counts[i] / units;
+  }
+  out << "}";
+}
+
+static void
+write_json(std::ostream & out, const Workload & w, const std::vector<KernelResult> & results,
+           const PerfCounters & counters)
+{
+  out << "{\n  \"width\": " << w.width << ", \"height\": " << w.height << ", \"patch_width\": " << w.patch_width
+      << ", \"patch_height\": " << w.patch_height << ", \"features\": " << w.num_features << ", \"samples\": "
+      << w.num_samples << ", \"min_rects\": " << w.min_rects << ", \"max_rects\": " << w.max_rects << ",\n";
+  out << "  \"perf_counters\": " << (counters.available() ? "true" : "false") << ",\n";
+  out << "  \"kernels\": [";
+  for (size_t k = 0; k < results.size(); k++)
+  {
+    const KernelResult & r = results[k];
+    out << (k ? ",\n" : "\n");
+    out << "    {\"name\": \"" << r.name << "\", \"integral_ns_per_pixel\": " << r.integral.ns / r.pixels
+        << ", \"ns_per_feature\": " << r.features.ns / r.evaluations << ", \"ns_per_rect\": "
+        << r.features.ns / r.rects << ", \"rects_per_feature\": " << r.rects / r.evaluations;
+    if (r.max_error >= 0)
+      out << ", \"max_error_vs_ct\": " << r.max_error;
+    out << ",\n     \"integral\": ";
+    write_measure(out, r.integral, r.pixels, counters);
+    out << ",\n     \"features\": ";
+    write_measure(out, r.features, r.evaluations, counters);
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+static bool
+read_pair(const char* arg, int & a, int & b)
+{
+  return sscanf(arg, "%d,%d", &a, &b) == 2;
+}
+
+static void
+print_help(const char* program)
+{
+  printf("use: %s [-w width] [-h height] [-p patch_width,patch_height] [-f features] [-s samples]\n"
+         "       [-r min_rects,max_rects] [-t seconds] [-o results.json]\n"
+         "defaults: 320x240 image, 40x40 patch, 250 features, 1000 samples, 2-6 rectangles, 0.2 s per kernel\n",
+         program);
+}
+
+int
+main(int argc, char** argv)
+{
+  Workload w;
+  w.width = 320;
+  w.height = 240;
+  w.patch_width = 40;
+  w.patch_height = 40;
+  w.num_features = 250;
+  w.num_samples = 1000;
+  w.min_rects = 2;
+  w.max_rects = 6;
+  double seconds = 0.2;
+  const char* output = NULL;
+
+  for (int i = 1; i < argc; i++)
+  {
+    bool ok = i + 1 < argc;
+    if (ok && strcmp(argv[i], "-w") == 0)
+      w.width = atoi(argv[++i]);
+    else if (ok && strcmp(argv[i], "-h") == 0)
+      w.height = atoi(argv[++i]);
+    else if (ok && strcmp(argv[i], "-p") == 0)
+      ok = read_pair(argv[++i], w.patch_width, w.patch_height);
+    else if (ok && strcmp(argv[i], "-f") == 0)
+      w.num_features = atoi(argv[++i]);
+    else if (ok && strcmp(argv[i], "-s") == 0)
+      w.num_samples = atoi(argv[++i]);
+    else if (ok && strcmp(argv[i], "-r") == 0)
+      ok = read_pair(argv[++i], w.min_rects, w.max_rects);
+    else if (ok && strcmp(argv[i], "-t") == 0)
+      seconds = atof(argv[++i]);
+    else if (ok && strcmp(argv[i], "-o") == 0)
+      output = argv[++i];
+    else
+      ok = false;
+    if (!ok)
+    {
+      print_help(argv[0]);
+      return 1;
+    }
+  }
+  if (w.patch_width < 5 || w.patch_height < 5 || w.patch_width + 2 > w.width || w.patch_height + 2 > w.height
+      || w.num_features < 1 || w.num_samples < 1 || w.min_rects < 1 || w.max_rects < w.min_rects)
+  {
+    print_help(argv[0]);
+    return 1;
+  }
+
+  // Single-threaded kernels: OpenCV's integral and the MIL OpenMP loops stay on one core
+  cv::setNumThreads(1);
+#ifdef _OPENMP
+  omp_set_num_threads(1);
+#endif
+  make_workload(w);
+  PerfCounters counters;
+
+  std::vector<KernelResult> results;
+  cv::Mat_<float> reference;
+  results.push_back(run_ct(w, seconds, counters, reference));
+  results.push_back(run_mil(w, seconds, counters, reference));
+  results.push_back(run_mil_virtual(w, seconds, counters, reference));
+  results.push_back(run_rct_mex(w, seconds, counters, reference));
+  const size_t num_table_kernels = results.size();
+  results.push_back(run_boosting(w, seconds, counters));
+  results.push_back(run_framework(w, seconds, counters));
+  for (size_t k = 0; k < results.size(); k++)
+  {
+    results[k].pixels = (double) w.width * w.height;
+    results[k].evaluations = (double) w.num_features * w.num_samples;
+    if (k < num_table_kernels)
+    {
+      results[k].rects = table_rects(w);
+    }
+  }
+
+  printf("%d x %d image, %d x %d patch, %d features x %d samples, %d-%d rectangles%s\n", w.width, w.height,
+         w.patch_width, w.patch_height, w.num_features, w.num_samples, w.min_rects, w.max_rects,
+         counters.available() ? "" : " (no perf counters)");
+  printf("%-12s %10s %12s %10s", "kernel", "ii ns/px", "ns/feature", "ns/rect");
+  for (int i = 0; i < NUM_COUNTERS; i++)
+  {
+    printf(" %12s", counter_names[i]);
+  }
+  printf(" %10s\n", "err vs ct");
+  for (size_t k = 0; k < results.size(); k++)
+  {
+    print_result(results[k], counters);
+  }
+
+  if (output)
+  {
+    std::ofstream out(output);
+    if (!out)
+    {
+      fprintf(stderr, "Could not open %s\n", output);
+      return 1;
+    }
+    write_json(out, w, results, counters);
+  }
+  return 0;
+}
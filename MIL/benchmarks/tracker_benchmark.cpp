@@ -0,0 +1,562 @@
+// Headless throughput benchmark of the tracking algorithms of the collection.
+//
+// Every algorithm of the TrackingAlgorithmRegistry (TLD and CT when the library is built
+// WITH_TLD / WITH_CT) is run on the sequences shipped with the repository:
+//
+//   david   MIL/data/david               462 frames
+//   car4    L1-APG/car4                  648 frames (from frame 12, as in Demo_Car4.m)
+//   tld     TLD/matlab/_input            100 frames
+//   vtd/*   VTD/VTD/VTD/video/data/*     first frame only (initialization)
+//
+// For each (algorithm, sequence) pair it reports frames/sec of update(), latency
+// percentiles of the decode, gray conversion, initialize and update stages (plus the
+// algorithm's own stages, see TrackingAlgorithm::stage_times), the peak RSS and the heap
+// allocations per frame.  The results are written as JSON.
+//
+//   TrackerBenchmark [-root dir] [-t mil,ct,...] [-s david,car4,...] [-n max_frames] [-o results.json]
+//
+// Allocations are counted by interposing malloc, which needs glibc; elsewhere only
+// operator new is counted.  The peak RSS is reset between runs through /proc on Linux and
+// is otherwise the peak of the whole process.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <new>
+#include <cmath>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <opencv2/highgui/highgui.hpp>
+#include <object_tracker.h>
+
+#ifndef TRACKING_DATA_ROOT
+#define TRACKING_DATA_ROOT ".."
+#endif
+
+//
+// Heap allocation counters
+//
+
+static volatile bool count_allocations = false;
+static unsigned long long allocations = 0;
+static unsigned long long allocated_bytes = 0;
+
+static inline void
+record_allocation(size_t size)
+{
+  if (count_allocations)
+  {
+    __sync_fetch_and_add(&allocations, 1ULL);
+    __sync_fetch_and_add(&allocated_bytes, (unsigned long long)size);
+  }
+}
+
+#if defined(__GLIBC__)
+// Every malloc of the process, OpenCV's included, goes through these
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void* __libc_memalign(size_t alignment, size_t size);
+
+  void*
+  malloc(size_t size)
+  {
+    record_allocation(size);
+    return __libc_malloc(size);
+  }
+
+  void*
+  calloc(size_t n, size_t size)
+  {
+    record_allocation(n * size);
+    return __libc_calloc(n, size);
+  }
+
+  void*
+  realloc(void* ptr, size_t size)
+  {
+    record_allocation(size);
+    return __libc_realloc(ptr, size);
+  }
+
+  int
+  posix_memalign(void** ptr, size_t alignment, size_t size)
+  {
+    record_allocation(size);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+  }
+}
+#else
+void*
+operator new(size_t size)
+{
+  record_allocation(size);
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void
+operator delete(void* ptr) throw()
+{
+  free(ptr);
+}
+#endif
+
+//
+// Peak resident set size
+//
+
+static void
+reset_peak_rss()
+{
+  // Linux >= 4.0 resets VmHWM to the current RSS
+  FILE* f = fopen("/proc/self/clear_refs", "w");
+  if (f)
+  {
+    fputs("5", f);
+    fclose(f);
+  }
+}
+
+static long
+peak_rss_kb()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+  {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+    {
+      return atol(line.c_str() + 6);
+    }
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+//
+// Sequences
+//
+
+struct Sequence
+{
+  std::string name;
+  std::string pattern; // printf pattern of the frame files, relative to the data root
+  int first;
+  int last;
+  cv::Rect box;
+};
+
+// VTD boxes are "cx cy w h angle frame" on the first line of <name>.avi.txt
+static bool
+read_vtd_box(const std::string & file, cv::Rect & box)
+{
+  std::ifstream in(file.c_str());
+  int cx, cy, w, h;
+  if (!(in >> cx >> cy >> w >> h))
+  {
+    return false;
+  }
+  box = cv::Rect(cx - w / 2, cy - h / 2, w, h);
+  return true;
+}
+
+static std::vector<Sequence>
+standard_sequences(const std::string & root)
+{
+  std::vector<Sequence> sequences;
+  Sequence s;
+
+  s.name = "david";
+  s.pattern = "MIL/data/david/img%05d.png";
+  s.first = 1;
+  s.last = 462;
+  s.box = cv::Rect(122, 58, 75, 97);
+  sequences.push_back(s);
+
+  // Demo_Car4.m: init_pos (corners (65,55), (64,140), (170,53)) is given on start_frame 12
+  s.name = "car4";
+  s.pattern = "L1-APG/car4/%04d.jpg";
+  s.first = 12;
+  s.last = 659;
+  s.box = cv::Rect(64, 53, 106, 87);
+  sequences.push_back(s);
+
+  // init.txt: 288,36,313,78 (x1,y1,x2,y2)
+  s.name = "tld";
+  s.pattern = "TLD/matlab/_input/%05d.png";
+  s.first = 1;
+  s.last = 100;
+  s.box = cv::Rect(288, 36, 25, 42);
+  sequences.push_back(s);
+
+  const char* vtd[] = { "animal", "baseketball", "football", "shaking", "singer1", "singer2", "skating1", "skating2",
+                        "soccer" };
+  for (size_t i = 0; i < sizeof(vtd) / sizeof(vtd[0]); i++)
+  {
+    std::string dir = std::string("VTD/VTD/VTD/video/data/") + vtd[i];
+    if (!read_vtd_box(root + "/" + dir + "/" + vtd[i] + ".avi.txt", s.box))
+    {
+      continue;
+    }
+    s.name = std::string("vtd/") + vtd[i];
+    s.pattern = dir + "/frame/frame_%04d.jpg";
+    s.first = 1;
+    s.last = 1;
+    sequences.push_back(s);
+  }
+
+  return sequences;
+}
+
+//
+// Latency statistics
+//
+
+struct Stage
+{
+  std::string name;
+  std::vector<double> ms;
+};
+
+static Stage&
+stage(std::vector<Stage> & stages, const std::string & name)
+{
+  for (size_t i = 0; i < stages.size(); i++)
+  {
+    if (stages[i].name == name)
+    {
+      return stages[i];
+    }
+  }
+  stages.push_back(Stage());
+  stages.back().name = name;
+  return stages.back();
+}
+
+// Nearest-rank percentile of sorted samples
+static double
+percentile(const std::vector<double> & sorted, double p)
+{
+  if (sorted.empty())
+  {
+    return 0;
+  }
+  size_t rank = (size_t)std::max(0.0, std::ceil(p / 100.0 * sorted.size()) - 1);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+static double
+elapsed_ms(int64 start)
+{
+  return ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+//
+// Runs
+//
+
+struct RunResult
+{
+  std::string algorithm;
+  std::string sequence;
+  bool initialized;
+  int frames;          // frames given to update()
+  int found;           // frames update() reported the object on
+  double update_ms;    // total time in update()
+  long peak_rss_kb;
+  unsigned long long init_allocations;
+  unsigned long long allocations;     // in update()
+  unsigned long long allocated_bytes; // in update()
+  std::vector<Stage> stages;
+};
+
+static RunResult
+run(const std::string & algorithm, const Sequence & sequence, const std::string & root, int max_frames)
+{
+  RunResult result;
+  result.algorithm = algorithm;
+  result.sequence = sequence.name;
+  result.initialized = false;
+  result.frames = 0;
+  result.found = 0;
+  result.update_ms = 0;
+  result.init_allocations = 0;
+
+  cv::ObjectTrackerParams params;
+  cv::TrackingAlgorithm* tracker = cv::TrackingAlgorithmRegistry::create(algorithm);
+
+  reset_peak_rss();
+  allocations = 0;
+  allocated_bytes = 0;
+
+  char filename[1024];
+  cv::Mat frame, gray;
+  cv::Rect track_box;
+  std::vector<std::pair<std::string, float> > internal;
+  int last = sequence.last;
+  if (max_frames > 0)
+  {
+    last = std::min(last, sequence.first + max_frames - 1);
+  }
+  for (int i = sequence.first; i <= last; i++)
+  {
+    sprintf(filename, (root + "/" + sequence.pattern).c_str(), i);
+
+    int64 t = cv::getTickCount();
+    frame = cv::imread(filename);
+    stage(result.stages, "decode").ms.push_back(elapsed_ms(t));
+    if (frame.empty())
+    {
+      std::cerr << "Error loading image file: " << filename << "!\n";
+      break;
+    }
+
+    t = cv::getTickCount();
+    cv::TrackingAlgorithm::import_gray(frame, gray);
+    stage(result.stages, "convert").ms.push_back(elapsed_ms(t));
+
+    // Allocations are counted inside the tracker only
+    count_allocations = true;
+    t = cv::getTickCount();
+    bool ok;
+    if (i == sequence.first)
+    {
+      ok = result.initialized = tracker->initialize(gray, params, sequence.box);
+    }
+    else
+    {
+      ok = tracker->update(gray, params, track_box);
+    }
+    double ms = elapsed_ms(t);
+    count_allocations = false;
+
+    if (i == sequence.first)
+    {
+      stage(result.stages, "initialize").ms.push_back(ms);
+      result.init_allocations = allocations;
+      allocations = 0;
+      allocated_bytes = 0;
+      if (!ok)
+      {
+        break;
+      }
+    }
+    else
+    {
+      stage(result.stages, "update").ms.push_back(ms);
+      result.update_ms += ms;
+      result.frames++;
+      if (ok)
+      {
+        result.found++;
+      }
+      tracker->stage_times(internal);
+      for (size_t k = 0; k < internal.size(); k++)
+      {
+        stage(result.stages, algorithm + "/" + internal[k].first).ms.push_back(internal[k].second);
+      }
+    }
+  }
+
+  result.allocations = allocations;
+  result.allocated_bytes = allocated_bytes;
+  delete tracker;
+  result.peak_rss_kb = peak_rss_kb();
+  return result;
+}
+
+//
+// Output
+//
+
+static void
+write_json(std::ostream & out, const std::vector<RunResult> & results)
+{
+  char buffer[64];
+  time_t now = time(NULL);
+  strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  out << "{\n  \"date\": \"" << buffer << "\",\n";
+#ifdef __VERSION__
+  out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+  out << "  \"opencv\": \"" << CV_VERSION << "\",\n";
+  out << "  \"runs\": [";
+  for (size_t r = 0; r < results.size(); r++)
+  {
+    const RunResult & res = results[r];
+    out << (r ? ",\n" : "\n");
+    out << "    {\n";
+    out << "      \"algorithm\": \"" << res.algorithm << "\",\n";
+    out << "      \"sequence\": \"" << res.sequence << "\",\n";
+    out << "      \"initialized\": " << (res.initialized ? "true" : "false") << ",\n";
+    out << "      \"frames\": " << res.frames << ",\n";
+    out << "      \"found\": " << res.found << ",\n";
+    out << "      \"fps\": " << (res.update_ms > 0 ? 1000.0 * res.frames / res.update_ms : 0) << ",\n";
+    out << "      \"peak_rss_kb\": " << res.peak_rss_kb << ",\n";
+    out << "      \"init_allocations\": " << res.init_allocations << ",\n";
+    out << "      \"allocations_per_frame\": " << (double)res.allocations / std::max(res.frames, 1) << ",\n";
+    out << "      \"bytes_per_frame\": " << (double)res.allocated_bytes / std::max(res.frames, 1) << ",\n";
+    out << "      \"stages\": {";
+    for (size_t s = 0; s < res.stages.size(); s++)
+    {
+      std::vector<double> sorted = res.stages[s].ms;
+      std::sort(sorted.begin(), sorted.end());
+      double total = 0;
+      for (size_t k = 0; k < sorted.size(); k++)
+      {
+        total += sorted[k];
+      }
+      out << (s ? ",\n" : "\n");
+      out << "        \"" << res.stages[s].name << "\": {\"count\": " << sorted.size() << ", \"mean_ms\": "
+          << (sorted.empty() ? 0 : total / sorted.size()) << ", \"p50_ms\": " << percentile(sorted, 50)
+          << ", \"p90_ms\": " << percentile(sorted, 90) << ", \"p99_ms\": " << percentile(sorted, 99)
+          << ", \"max_ms\": " << (sorted.empty() ? 0 : sorted.back()) << "}";
+    }
+    out << "\n      }\n    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+static std::vector<std::string>
+split_list(const std::string & list)
+{
+  std::vector<std::string> items;
+  std::stringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ','))
+  {
+    if (!item.empty())
+    {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+static void
+print_help(const char* program)
+{
+  std::cout << "use: " << program << " [-root dir] [-t algorithms] [-s sequences] [-n max_frames] [-o results.json]\n"
+            << "-root  data root, the top of the repository (default " << TRACKING_DATA_ROOT << ")\n"
+            << "-t     comma separated algorithms (default: all registered but linemod)\n"
+            << "-s     comma separated sequences (default: all)\n"
+            << "-n     maximum frames per sequence\n"
+            << "-o     JSON output (default: standard output)\n";
+}
+
+int
+main(int argc, char** argv)
+{
+  std::string root = TRACKING_DATA_ROOT;
+  std::vector<std::string> algorithms;
+  std::vector<std::string> sequence_names;
+  const char* output = NULL;
+  int max_frames = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 >= argc)
+    {
+      print_help(argv[0]);
+      return 1;
+    }
+    if (strcmp(argv[i], "-root") == 0)
+      root = argv[++i];
+    else if (strcmp(argv[i], "-t") == 0)
+      algorithms = split_list(argv[++i]);
+    else if (strcmp(argv[i], "-s") == 0)
+      sequence_names = split_list(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0)
+      max_frames = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-o") == 0)
+      output = argv[++i];
+    else
+    {
+      print_help(argv[0]);
+      return 1;
+    }
+  }
+
+  // LINEMOD is a stub
+  if (algorithms.empty())
+  {
+    std::vector<std::string> names = cv::TrackingAlgorithmRegistry::names();
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      if (names[i] != "linemod")
+      {
+        algorithms.push_back(names[i]);
+      }
+    }
+  }
+
+  std::vector<Sequence> sequences;
+  std::vector<Sequence> all = standard_sequences(root);
+  for (size_t i = 0; i < all.size(); i++)
+  {
+    if (sequence_names.empty() || std::find(sequence_names.begin(), sequence_names.end(), all[i].name)
+        != sequence_names.end())
+    {
+      sequences.push_back(all[i]);
+    }
+  }
+
+  std::vector<RunResult> results;
+  for (size_t a = 0; a < algorithms.size(); a++)
+  {
+    cv::TrackingAlgorithm* probe = cv::TrackingAlgorithmRegistry::create(algorithms[a]);
+    if (probe == NULL)
+    {
+      std::cerr << "Unknown tracking algorithm '" << algorithms[a] << "'\n";
+      return 1;
+    }
+    delete probe;
+
+    for (size_t s = 0; s < sequences.size(); s++)
+    {
+      RunResult result = run(algorithms[a], sequences[s], root, max_frames);
+      std::cerr << result.algorithm << " / " << result.sequence << ": " << result.frames << " frames, "
+                << (result.update_ms > 0 ? 1000.0 * result.frames / result.update_ms : 0) << " fps, "
+                << result.peak_rss_kb << " KB peak\n";
+      results.push_back(result);
+    }
+  }
+
+  if (output)
+  {
+    std::ofstream out(output);
+    if (!out)
+    {
+      std::cerr << "Could not open " << output << "\n";
+      return 1;
+    }
+    write_json(out, results);
+  }
+  else
+  {
+    write_json(std::cout, results);
+  }
+  return 0;
+}
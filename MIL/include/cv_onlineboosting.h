@@ -45,6 +45,8 @@
 
 #include <opencv2/core/core.hpp>
 
+#include "haar_features.h"
+
 namespace cv
 {
   namespace boosting
@@ -862,6 +864,48 @@ namespace cv
       float priorConfidence;
     };
 
+    /** Beyond Semi-Supervised Tracking (Stalder, Grabner, Van Gool, ICCV-WS 2009): an off-line
+     *  detector, an on-line recognizer and a tracking classifier, all updated against a background
+     *  image that the caller keeps (the frame without the object) */
+    class BeyondSemiBoostingTracker
+    {
+    public:
+      BeyondSemiBoostingTracker(ImageRepresentation* image, ImageRepresentation* backgroundImage, Rect initPatch,
+                                Rect validROI, int numBaseClassifier);
+
+      bool
+      track(ImageRepresentation* image, ImageRepresentation* BGMRep, Patches* patches);
+
+      Rect
+      getTrackingROI(float searchFactor);
+      float
+      getConfidence();
+      Rect
+      getTrackedPatch();
+      cv::Point2i
+      getCenter();
+
+    private:
+      void
+      initClassifier(Rect initPatch, ImageRepresentation* image, Patches* patches, bool offUpdate, bool onUpdate,
+                     bool classifierUpdate);
+      void
+      initClassifierOff(Rect initPatch, ImageRepresentation* image, ImageRepresentation* BGMRep, Patches* patches);
+      bool
+      updateOn(ImageRepresentation* image, ImageRepresentation* BGMRep, Patches* patches);
+      bool
+      update(ImageRepresentation* image, ImageRepresentation* BGMRep, Patches* patches);
+
+      cv::Ptr<StrongClassifierStandardSemi> classifierOff;
+      cv::Ptr<StrongClassifierStandardSemi> classifierOn;
+      cv::Ptr<StrongClassifierStandardSemi> classifier;
+      int numBaseClassifier;
+      Rect validROI;
+      Rect trackedPatch;
+      float confidence;
+      float offThreshold;
+    };
+
   }
 }
 
@@ -54,6 +54,45 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/objdetect/objdetect.hpp>
 
+#include "haar_features.h"
+
+namespace cv
+{
+  namespace mil
+  {
+    /** Integral images (CV_32F) of the channels of a frame, interleaved in a single buffer: the integral of
+     * channel c at (y, x) is sum(y, x * channels + c).
+     */
+    struct IntegralImage
+    {
+      cv::Mat_<float> sum;
+      int channels;
+
+      IntegralImage()
+          :
+            channels(0)
+      {
+      }
+      bool
+      empty() const
+      {
+        return sum.empty();
+      }
+      void
+      release()
+      {
+        sum.release();
+        channels = 0;
+      }
+    };
+  }
+}
+
+// Integral images of every channel of img in one pass, as used by the samples. With gradient, a last channel
+// holds the gradient magnitude (8-bit images only).
+void
+compute_integral(const cv::Mat & img, cv::mil::IntegralImage & ii, bool gradient = false);
+
 namespace cv
 {
   namespace mil
@@ -68,30 +107,113 @@ namespace cv
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////
     // random generator stuff
-    struct RandomGenerator
+
+    /** Counter-based random numbers (Philox4x32-10). The n-th number of a stream only depends on the seed, the
+     * stream id and n: every tracker draws from its own streams, a stream can skip ahead, and the iterations of
+     * a parallel loop draw the numbers at fixed positions, so that the results do not depend on the threads.
+     */
+    class RandomStream
     {
     public:
-      static
+      explicit
+      RandomStream(uint64 seed = 0, uint64 stream = 0)
+      {
+        init(seed, stream);
+      }
+
       void
-      initialize(const int init)
+      init(uint64 seed, uint64 stream = 0)
       {
-        rng_ = cv::RNG(init);
+        _key[0] = (unsigned int) seed;
+        _key[1] = (unsigned int) (seed >> 32);
+        _stream = stream;
+        _pos = 0;
+        _block = ~(uint64) 0;
       }
 
-      static
-      int
-      randint(const int min, const int max)
+      // position of the next number
+      uint64
+      pos() const
       {
-        return rng_.uniform(min, max);
+        return _pos;
+      }
+      void
+      skip(uint64 n)
+      {
+        _pos += n;
       }
 
-      static
+      // the number at position n, without moving the stream
+      unsigned int
+      at(uint64 n) const
+      {
+        unsigned int out[4];
+        philox(n >> 2, out);
+        return out[n & 3];
+      }
+      unsigned int
+      next()
+      {
+        uint64 block = _pos >> 2;
+        if (block != _block)
+        {
+          philox(block, _out);
+          _block = block;
+        }
+        return _out[_pos++ & 3];
+      }
+
+      // uniform in [min, max), as cv::RNG::uniform
+      static int
+      toInt(unsigned int u, int min, int max)
+      {
+        return max > min ? min + (int) (((uint64) u * (unsigned int) (max - min)) >> 32) : min;
+      }
+      static float
+      toFloat(unsigned int u, float min = 0, float max = 1)
+      {
+        return min + (max - min) * ((u >> 8) * (1.0f / 16777216.0f));
+      }
+      int
+      randint(int min, int max)
+      {
+        return toInt(next(), min, max);
+      }
       float
-      randfloat(const float min = 0, const float max = 1)
+      randfloat(float min = 0, float max = 1)
       {
-        return rng_.uniform(min, max);
+        return toFloat(next(), min, max);
       }
-      static cv::RNG rng_;
+
+    private:
+      void
+      philox(uint64 block, unsigned int out[4]) const
+      {
+        unsigned int c0 = (unsigned int) block, c1 = (unsigned int) (block >> 32);
+        unsigned int c2 = (unsigned int) _stream, c3 = (unsigned int) (_stream >> 32);
+        unsigned int k0 = _key[0], k1 = _key[1];
+        for (int round = 0; round < 10; round++)
+        {
+          uint64 p0 = (uint64) 0xD2511F53u * c0, p1 = (uint64) 0xCD9E8D57u * c2;
+          unsigned int n0 = (unsigned int) (p1 >> 32) ^ c1 ^ k0, n2 = (unsigned int) (p0 >> 32) ^ c3 ^ k1;
+          c0 = n0;
+          c1 = (unsigned int) p1;
+          c2 = n2;
+          c3 = (unsigned int) p0;
+          k0 += 0x9E3779B9u;
+          k1 += 0xBB67AE85u;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+      }
+
+      unsigned int _key[2];
+      uint64 _stream;
+      uint64 _pos;
+      uint64 _block; // block of 4 numbers in _out
+      unsigned int _out[4];
     };
 
     inline float
@@ -212,38 +334,58 @@ namespace cv
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////
 
+    /** A sample is a window of the frame of its SampleSet
+     */
     class Sample
     {
     public:
-      Sample(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_imgs, int row, int col, int width = 0,
-             int height = 0, float weight = 1.0);
+      Sample(int row, int col, int width = 0, int height = 0, float weight = 1.0);
       Sample()
       {
         _row = _col = _height = _width = 0;
         _weight = 1.0f;
       }
-      Sample&
-      operator=(const Sample &a);
 
     public:
-      cv::Mat _img;
-      std::vector<cv::Mat_<float> > _ii_imgs;
       int _row, _col, _width, _height;
       float _weight;
 
     };
 
+    /** Values of one feature for all the samples of a set, without a copy
+     */
+    struct FtrSpan
+    {
+      const float *data;
+      int size;
+
+      const float &
+      operator[](int i) const
+      {
+        return data[i];
+      }
+    };
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     class SampleSet
     {
     public:
+      // the feature value rows start on cache lines (multiples of FTR_ALIGN floats)
+      static const int FTR_ALIGN = 16;
+
       SampleSet()
+          :
+            _numFtrsComputed(0),
+            _scale(1.0f)
       {
       }
       ;
       SampleSet(const Sample &s)
+          :
+            _numFtrsComputed(0),
+            _scale(1.0f)
       {
         _samples.push_back(s);
       }
@@ -255,6 +397,37 @@ namespace cv
         return _samples.size();
       }
       ;
+      // the frame and integral images all the samples are taken from; set it before
+      // pushing samples (sampleImage sets it itself)
+      void
+      setImage(const cv::Mat & img, const IntegralImage & ii)
+      {
+        _img = img;
+        _ii = ii;
+      }
+      const cv::Mat &
+      img() const
+      {
+        return _img;
+      }
+      const IntegralImage &
+      integral() const
+      {
+        return _ii;
+      }
+      // size of the samples relative to the feature patch: the features are rescaled accordingly
+      void
+      setScale(float scale)
+      {
+        if (scale != _scale)
+          _ftrVals.release();
+        _scale = scale;
+      }
+      float
+      scale() const
+      {
+        return _scale;
+      }
       void
       push_back(const Sample &s)
       {
@@ -262,26 +435,24 @@ namespace cv
       }
       ;
       void
-      push_back(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_img, int x, int y, int width = 0,
-                int height = 0, float weight = 1.0f);
-      void
       resize(int i)
       {
         _samples.resize(i);
       }
       ;
+      // allocates the rows of i features, none computed yet
       void
       resizeFtrs(int i);
       float &
       getFtrVal(int sample, int ftr)
       {
-        return _ftrVals[ftr](sample);
+        return _ftrVals(ftr, sample);
       }
       ;
       float
       getFtrVal(int sample, int ftr) const
       {
-        return _ftrVals[ftr](sample);
+        return _ftrVals(ftr, sample);
       }
       ;
       Sample &
@@ -290,78 +461,100 @@ namespace cv
         return _samples[sample];
       }
       ;
-      Sample
+      const Sample &
       operator[](const int sample) const
       {
         return _samples[sample];
       }
       ;
-      const cv::Mat_<float> &
+      FtrSpan
       ftrVals(int ftr) const
       {
-        return _ftrVals[ftr];
+        FtrSpan span =
+        { _ftrVals[ftr], _ftrVals.cols };
+        return span;
+      }
+      // number of feature rows allocated for the current samples
+      int
+      numFtrs() const
+      {
+        return (!_samples.empty() && _ftrVals.cols == (int) _samples.size()) ? _ftrVals.rows : 0;
+      }
+      // features are computed lazily: a row is valid once marked computed
+      bool
+      ftrComputed(int ftr) const
+      {
+        return ftr >= 0 && ftr < numFtrs() && _ftrComputed[ftr];
+      }
+      void
+      setFtrComputed(int ftr)
+      {
+        if (!_ftrComputed[ftr])
+        {
+          _ftrComputed[ftr] = 1;
+          _numFtrsComputed++;
+        }
       }
       bool
       ftrsComputed() const
       {
-        return !_ftrVals.empty() && !_samples.empty() && !_ftrVals[0].empty();
+        return numFtrs() > 0 && _numFtrsComputed == numFtrs();
       }
       ;
+      // keeps the sample and feature value buffers for the next frame
       void
       clear()
       {
-        _ftrVals.clear();
+        _ftrVals.release();
         _samples.clear();
+        _img.release();
+        _ii.release();
+        _scale = 1.0f;
       }
       ;
 
       // densely sample the image in a donut shaped region: will take points inside circle of radius inrad,
       // but outside of the circle of radius outrad.  when outrad=0 (default), then just samples points inside a circle
+      // When there are more than maxnum such points, maxnum of them are drawn from rng.
+      // Both replace the samples and the frame of the set.
       void
-      sampleImage(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_imgs, int x, int y, int w, int h,
+      sampleImage(const cv::Mat & img, const IntegralImage & ii, RandomStream & rng, int x, int y, int w, int h,
                   float inrad, float outrad = 0, int maxnum = 1000000);
+      // num points uniformly over the image
       void
-      sampleImage(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_imgs, uint num, int w, int h);
+      sampleImage(const cv::Mat & img, const IntegralImage & ii, RandomStream & rng, uint num, int w, int h);
 
     private:
       std::vector<Sample> _samples;
-      std::vector<cv::Mat_<float> > _ftrVals; // [ftr][sample]
+      cv::Mat _img;
+      IntegralImage _ii;
+      cv::Mat_<float> _ftrVals; // [ftr][sample], in _ftrBuf
+      cv::Mat_<float> _ftrBuf;
+      std::vector<char> _ftrComputed; // [ftr]
+      int _numFtrsComputed;
+      float _scale;
     };
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    inline Sample&
-    Sample::operator=(const Sample &a)
-    {
-      _img = a._img;
-      _row = a._row;
-      _col = a._col;
-      _width = a._width;
-      _height = a._height;
-
-      return (*this);
-    }
-
-    //////////////////////////////////////////////////////////////////////////////////////////////////////////
-    //////////////////////////////////////////////////////////////////////////////////////////////////////////
     inline void
     SampleSet::resizeFtrs(int nftr)
     {
-      _ftrVals.resize(nftr);
       int nsamp = _samples.size();
 
-      if (nsamp > 0)
-        for (int k = 0; k < nftr; k++)
-          _ftrVals[k].create(1, nsamp);
-    }
-
-    inline void
-    SampleSet::push_back(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_imgs, int x, int y, int width,
-                         int height, float weight)
-    {
-      Sample s(img, ii_imgs, y, x, width, height, weight);
-      push_back(s);
+      _ftrComputed.assign(nftr, 0);
+      _numFtrsComputed = 0;
+      if (nsamp == 0 || nftr == 0)
+      {
+        _ftrVals.release();
+        return;
+      }
+      int step = (nsamp + FTR_ALIGN - 1) / FTR_ALIGN * FTR_ALIGN;
+      if (_ftrBuf.total() < (size_t) (nftr * step + FTR_ALIGN))
+        _ftrBuf.create(1, nftr * step + FTR_ALIGN);
+      float* data = cv::alignPtr((float*) _ftrBuf.data, FTR_ALIGN * sizeof(float));
+      _ftrVals = cv::Mat_<float>(nftr, nsamp, data, step * sizeof(float));
     }
 
     class Ftr;
@@ -373,8 +566,14 @@ namespace cv
     {
     public:
       uint _width, _height;
+      bool _gradient; // the integral images get a gradient magnitude channel, after the image channels
 
     public:
+      FtrParams()
+          :
+            _gradient(false)
+      {
+      }
       virtual int
       ftrType()=0;
       virtual
@@ -388,7 +587,7 @@ namespace cv
     public:
       HaarFtrParams();
       uint _maxNumRect, _minNumRect;
-      int _useChannels[1024];
+      int _useChannels[1024]; // integral image channels the features draw from (-1: unused); the gradient one is img.channels()
       int _numCh;
 
     public:
@@ -410,9 +609,9 @@ namespace cv
       {
       }
       virtual float
-      compute(const Sample &sample) const =0;
+      compute(const SampleSet &samples, int sample) const =0;
       virtual void
-      generate(FtrParams *params) = 0;
+      generate(FtrParams *params, RandomStream &rng) = 0;
       virtual cv::Mat
       toViz()
       {
@@ -425,10 +624,13 @@ namespace cv
       }
       static void
       compute(SampleSet &samples, const vecFtr &ftrs);
+      // only the features ftrs[which[k]] not computed yet for these samples
+      static void
+      compute(SampleSet &samples, const vecFtr &ftrs, const vectori &which);
       static void
       compute(SampleSet &samples, Ftr *ftr, int ftrind);
       static vecFtr
-      generate(FtrParams *params, uint num);
+      generate(FtrParams *params, uint num, RandomStream &rng);
       static void
       deleteFtrs(vecFtr ftrs);
       static void
@@ -458,9 +660,9 @@ namespace cv
       expectedValue() const;
 
       virtual float
-      compute(const Sample &sample) const;
+      compute(const SampleSet &samples, int sample) const;
       virtual void
-      generate(FtrParams *params);
+      generate(FtrParams *params, RandomStream &rng);
       virtual cv::Mat
       toViz();
       virtual int
@@ -469,40 +671,59 @@ namespace cv
         return 0;
       }
       ;
+      // rectangle k for samples scale times the patch size; its weight is normalized by the area, so that
+      // the feature value does not depend on the scale
+      cv::Rect
+      scaledRect(int k, float scale, float &weight) const;
 
     };
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     inline float
-    HaarFtr::compute(const Sample &sample) const
+    HaarFtr::compute(const SampleSet &samples, int i) const
     {
-      if (sample._ii_imgs.empty())
+      const IntegralImage & ii = samples.integral();
+      if (ii.empty())
         abortError(__LINE__, __FILE__, "Integral image not initialized before called compute()");
-      cv::Rect r;
+      if ((int) _channel >= ii.channels)
+        abortError(__LINE__, __FILE__, "Feature channel not in the integral image");
+      const Sample & sample = samples[i];
+      const float* data = (const float*) ii.sum.data + _channel;
+      const int step = (int) ii.sum.step1();
+      const float scale = samples.scale();
       float sum = 0.0f;
 
       for (int k = 0; k < (int) _rects.size(); k++)
       {
-        r = _rects[k];
-        r.x += sample._col;
-        r.y += sample._row;
-        sum +=
-            _weights[k] * (sample._ii_imgs[_channel](r.y + r.height, r.x + r.width)
-                + sample._ii_imgs[_channel](r.y, r.x)
-                           - sample._ii_imgs[_channel](r.y + r.height, r.x)
-                           - sample._ii_imgs[_channel](r.y, r.x + r.width)); ///_rsums[k];
+        float weight;
+        const cv::Rect r = scaledRect(k, scale, weight);
+        sum += weight * haar::rect_sum(data, step, ii.channels, sample._col + r.x, sample._row + r.y, r.width,
+                                       r.height); ///_rsums[k];
       }
 
-      r.x = sample._col;
-      r.y = sample._row;
-      r.width = (int) sample._weight;
-      r.height = (int) sample._height;
-
       return (float) (sum);
       //return (float) (100*sum/sample._img->sumRect(r,_channel));
     }
 
+    inline cv::Rect
+    HaarFtr::scaledRect(int k, float scale, float &weight) const
+    {
+      weight = _weights[k];
+      if (scale == 1.0f)
+        return _rects[k];
+
+      // the corners are rounded, so that the rectangle stays within the scaled patch
+      const cv::Rect & r = _rects[k];
+      cv::Rect sr;
+      sr.x = cvRound(r.x * scale);
+      sr.y = cvRound(r.y * scale);
+      sr.width = std::max(1, cvRound((r.x + r.width) * scale) - sr.x);
+      sr.height = std::max(1, cvRound((r.y + r.height) * scale) - sr.y);
+      weight *= (float) (r.width * r.height) / (float) (sr.width * sr.height);
+      return sr;
+    }
+
     inline HaarFtr&
     HaarFtr::operator=(const HaarFtr &a)
     {
@@ -540,7 +761,8 @@ namespace cv
             _ftrParams(0),
             _weakLearner("stump"),
             _lRate(0.85f),
-            _storeFtrHistory(false)
+            _storeFtrHistory(false),
+            _seed(0)
       {
       }
       virtual
@@ -554,6 +776,7 @@ namespace cv
       std::string _weakLearner; // "stump" or "wstump"; current code only uses "stump"
       float _lRate; // learning rate for weak learners;
       bool _storeFtrHistory;
+      uint64 _seed; // seed of the random features
     };
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -591,6 +814,10 @@ namespace cv
       makeClf(ClfStrongParams *clfparams);
       static cv::Mat_<float>
       applyToImage(ClfStrong *clf, const cv::Mat & img, bool logR = true); // returns a probability map (or log odds ratio map if logR=true)
+      // the same for the boxes whose top left corner is in roi: the map is roi sized, locations where the box does
+      // not fit in the image hold -FLT_MAX
+      static cv::Mat_<float>
+      applyToImage(ClfStrong *clf, const cv::Mat & img, const cv::Rect & roi, bool logR = true);
 
       static void
       eval(vectorf ppos, vectorf pneg, float &err, float &fp, float &fn, float thresh = 0.5f);
@@ -677,6 +904,9 @@ namespace cv
       std::vector<ClfWeak*> _weakclf;
       uint _numsamples;
       ClfMilBoostParams *_myParams;
+      // update() scratch, kept across frames
+      vectorf _Hpos, _Hneg;
+      std::vector<vectorf> _pospred, _negpred; // [weak clf][sample]
 
     public:
       ClfMilBoost()
@@ -725,15 +955,15 @@ namespace cv
       classifySetF(SampleSet &x);
 
       float
-      ftrcompute(const Sample &x)
+      ftrcompute(const SampleSet &x, int i)
       {
-        return _ftr->compute(x);
+        return _ftr->compute(x, i);
       }
       ;
       float
       getFtrVal(const SampleSet &x, int i)
       {
-        return (x.ftrsComputed()) ? x.getFtrVal(i, _ind) : _ftr->compute(x[i]);
+        return (x.ftrComputed(_ind)) ? x.getFtrVal(i, _ind) : _ftr->compute(x, i);
       }
       ;
 
@@ -788,6 +1018,13 @@ namespace cv
       virtual void
       copy(const ClfWeak* c);
 
+      /** Sum over the selected weak clfs of classifyF(x, j) for all samples j, or of +-alphas[s] by
+       * classify(x, j) when alphas is given, without virtual calls. Only when all the selected weak clfs
+       * are ClfOnlineStump and the feature values of x are computed; returns false otherwise.
+       */
+      static bool
+      classifyBatch(const std::vector<ClfWeak*> &weakclf, const vectori &selectors, const SampleSet &x,
+                    const float *alphas, vectorf &res);
     };
 
     class ClfWStump: public ClfWeak
@@ -859,29 +1096,80 @@ namespace cv
       }
       return res;
     }
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // statistics of feature values, accumulated in double as cv::mean and cv::meanStdDev do
+
+    inline double
+    ftrMean(const FtrSpan &v)
+    {
+      double sum = 0;
+      for (int i = 0; i < v.size; i++)
+        sum += v[i];
+      return sum / v.size;
+    }
+
+    // mean of (v - mu)^2
+    inline double
+    ftrMeanSqDiff(const FtrSpan &v, float mu)
+    {
+      double sum = 0;
+      for (int i = 0; i < v.size; i++)
+      {
+        float d = v[i] - mu;
+        sum += d * d;
+      }
+      return sum / v.size;
+    }
+
+    // mean and variance of v, or of v .* w when w is given
+    inline void
+    ftrMeanVar(const FtrSpan &v, const float *w, double &mean, double &var)
+    {
+      double sum = 0, sqsum = 0;
+      for (int i = 0; i < v.size; i++)
+      {
+        float x = w ? v[i] * w[i] : v[i];
+        sum += x;
+        sqsum += (double) x * x;
+      }
+      mean = sum / v.size;
+      var = std::max(sqsum / v.size - mean * mean, 0.0);
+    }
+
+    // w / (sum(w) + 1e-6)
+    inline void
+    normalizeWeights(const cv::Mat_<float> &w, vectorf &wn)
+    {
+      int n = (int) w.total();
+      double sum = 0;
+      for (int i = 0; i < n; i++)
+        sum += w(i);
+      wn.resize(n);
+      for (int i = 0; i < n; i++)
+        wn[i] = (float) (w(i) / (sum + 1e-6));
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     inline void
     ClfOnlineStump::update(SampleSet &posx, SampleSet &negx, const cv::Mat_<float> & posw, const cv::Mat_<float> & negw)
     {
       float posmu = 0.0, negmu = 0.0;
       if (posx.size() > 0)
-        posmu = cv::mean(posx.ftrVals(_ind))[0];
+        posmu = ftrMean(posx.ftrVals(_ind));
       if (negx.size() > 0)
-        negmu = cv::mean(negx.ftrVals(_ind))[0];
+        negmu = ftrMean(negx.ftrVals(_ind));
 
       if (_trained)
       {
         if (posx.size() > 0)
         {
           _mu1 = (_lRate * _mu1 + (1 - _lRate) * posmu);
-          cv::Mat diff = posx.ftrVals(_ind) - _mu1;
-          _sig1 = _lRate * _sig1 + (1 - _lRate) * cv::mean(diff.mul(diff))[0];
+          _sig1 = _lRate * _sig1 + (1 - _lRate) * ftrMeanSqDiff(posx.ftrVals(_ind), _mu1);
         }
         if (negx.size() > 0)
         {
           _mu0 = (_lRate * _mu0 + (1 - _lRate) * negmu);
-          cv::Mat diff = negx.ftrVals(_ind) - _mu0;
-          _sig0 = _lRate * _sig0 + (1 - _lRate) * cv::mean(diff.mul(diff))[0];
+          _sig0 = _lRate * _sig0 + (1 - _lRate) * ftrMeanSqDiff(negx.ftrVals(_ind), _mu0);
         }
 
         _q = (_mu1 - _mu0) / 2;
@@ -900,17 +1188,17 @@ namespace cv
         if (posx.size() > 0)
         {
           _mu1 = posmu;
-          cv::Scalar scal_mean, scal_std_dev;
-          cv::meanStdDev(posx.ftrVals(_ind), scal_mean, scal_std_dev);
-          _sig1 = scal_std_dev[0] * scal_std_dev[0] + 1e-9f;
+          double mean, var;
+          ftrMeanVar(posx.ftrVals(_ind), NULL, mean, var);
+          _sig1 = var + 1e-9f;
         }
 
         if (negx.size() > 0)
         {
           _mu0 = negmu;
-          cv::Scalar scal_mean, scal_std_dev;
-          cv::meanStdDev(negx.ftrVals(_ind), scal_mean, scal_std_dev);
-          _sig0 = scal_std_dev[0] * scal_std_dev[0] + 1e-9f;
+          double mean, var;
+          ftrMeanVar(negx.ftrVals(_ind), NULL, mean, var);
+          _sig0 = var + 1e-9f;
         }
 
         _q = (_mu1 - _mu0) / 2;
@@ -961,20 +1249,21 @@ namespace cv
     inline void
     ClfWStump::update(SampleSet &posx, SampleSet &negx, const cv::Mat_<float> & posw, const cv::Mat_<float> & negw)
     {
-      cv::Mat_<float> poswn, negwn;
+      vectorf poswn, negwn;
       if ((posx.size() != posw.size().area()) || (negx.size() != negw.size().area()))
         abortError(__LINE__, __FILE__, "ClfWStump::update - number of samples and number of weights mismatch");
 
-      float posmu = 0.0, negmu = 0.0;
+      // mean and variance of the weighted feature values
+      double posmu = 0.0, negmu = 0.0, posvar = 0.0, negvar = 0.0;
       if (posx.size() > 0)
       {
-        poswn = posw / (cv::sum(posw)[0] + 1e-6);
-        posmu = cv::mean(posx.ftrVals(_ind).mul(poswn))[0];
+        normalizeWeights(posw, poswn);
+        ftrMeanVar(posx.ftrVals(_ind), &poswn[0], posmu, posvar);
       }
       if (negx.size() > 0)
       {
-        negwn = negw / (cv::sum(negw)[0] + 1e-6);
-        negmu = cv::mean(negx.ftrVals(_ind).mul(negwn))[0];
+        normalizeWeights(negw, negwn);
+        ftrMeanVar(negx.ftrVals(_ind), &negwn[0], negmu, negvar);
       }
 
       if (_trained)
@@ -982,16 +1271,12 @@ namespace cv
         if (posx.size() > 0)
         {
           _mu1 = (_lRate * _mu1 + (1 - _lRate) * posmu);
-          cv::Scalar scal_mean, scal_std_dev;
-          cv::meanStdDev(posx.ftrVals(_ind).mul(poswn), scal_mean, scal_std_dev);
-          _sig1 = _lRate * _sig1 + (1 - _lRate) * scal_std_dev[0] * scal_std_dev[0];
+          _sig1 = _lRate * _sig1 + (1 - _lRate) * posvar;
         }
         if (negx.size() > 0)
         {
           _mu0 = (_lRate * _mu0 + (1 - _lRate) * negmu);
-          cv::Scalar scal_mean, scal_std_dev;
-          cv::meanStdDev(negx.ftrVals(_ind).mul(negwn), scal_mean, scal_std_dev);
-          _sig0 = _lRate * _sig0 + (1 - _lRate) * scal_std_dev[0] * scal_std_dev[0];
+          _sig0 = _lRate * _sig0 + (1 - _lRate) * negvar;
         }
       }
       else
@@ -999,17 +1284,10 @@ namespace cv
         _trained = true;
         _mu1 = posmu;
         _mu0 = negmu;
-        cv::Scalar scal_mean, scal_std_dev;
         if (negx.size() > 0)
-        {
-          cv::meanStdDev(negx.ftrVals(_ind).mul(negwn), scal_mean, scal_std_dev);
-          _sig0 = scal_std_dev[0] * scal_std_dev[0] + 1e-9f;
-        }
+          _sig0 = negvar + 1e-9f;
         if (posx.size() > 0)
-        {
-          cv::meanStdDev(posx.ftrVals(_ind).mul(poswn), scal_mean, scal_std_dev);
-          _sig1 = scal_std_dev[0] * scal_std_dev[0] + 1e-9f;
-        }
+          _sig1 = posvar + 1e-9f;
       }
 
       _log_n0 = std::log(float(1.0f / pow(_sig0, 0.5f)));
@@ -1041,21 +1319,27 @@ namespace cv
     ClfAdaBoost::classify(SampleSet &x, bool logR)
     {
       int numsamples = x.size();
-      vectorf res(numsamples);
+      vectorf res;
       vectorb tr;
 
-      // for each selector, accumate in the res vector
-      for (int sel = 0; sel < (int) _selectors.size(); sel++)
+      // only the selected features are needed
+      Ftr::compute(x, _ftrs, _selectors);
+      if (_selectors.empty() || !ClfOnlineStump::classifyBatch(_weakclf, _selectors, x, &_alphas[0], res))
       {
-        tr = _weakclf[_selectors[sel]]->classifySet(x);
+        res.assign(numsamples, 0.0f);
+        // for each selector, accumate in the res vector
+        for (int sel = 0; sel < (int) _selectors.size(); sel++)
+        {
+          tr = _weakclf[_selectors[sel]]->classifySet(x);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-        for (int j = 0; j < numsamples; j++)
-        {
-          res[j] += tr[j] ? _alphas[sel] : -_alphas[sel];
-        }
+          for (int j = 0; j < numsamples; j++)
+          {
+            res[j] += tr[j] ? _alphas[sel] : -_alphas[sel];
+          }
 
+        }
       }
 
       // return probabilities or log odds ratio
@@ -1077,18 +1361,24 @@ namespace cv
     ClfMilBoost::classify(SampleSet &x, bool logR)
     {
       int numsamples = x.size();
-      vectorf res(numsamples);
+      vectorf res;
       vectorf tr;
 
-      for (uint w = 0; w < _selectors.size(); w++)
+      // only the selected features are needed
+      Ftr::compute(x, _ftrs, _selectors);
+      if (!ClfOnlineStump::classifyBatch(_weakclf, _selectors, x, NULL, res))
       {
-        tr = _weakclf[_selectors[w]]->classifySetF(x);
+        res.assign(numsamples, 0.0f);
+        for (uint w = 0; w < _selectors.size(); w++)
+        {
+          tr = _weakclf[_selectors[w]]->classifySetF(x);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-        for (int j = 0; j < numsamples; j++)
-        {
-          res[j] += tr[j];
+          for (int j = 0; j < numsamples; j++)
+          {
+            res[j] += tr[j];
+          }
         }
       }
 
@@ -1146,6 +1436,7 @@ namespace cv
     public:
       TrackerParams();
 
+      uint64 _seed; // seed of the random sampling of the tracker
       vectori _boxcolor; // for outputting video
       uint _lineWidth; // line width
       uint _negnumtrain, _init_negnumtrain; // # negative samples to use during training, and init
@@ -1169,6 +1460,8 @@ namespace cv
 
       uint _srchwinsz; // size of search window
       uint _negsamplestrat; // [0] all over image [1 - default] close to the search window
+      vectorf _scales; // scales searched around the current one, e.g. {0.95, 1, 1.05} [empty - default: fixed size]
+      bool _storeResponse; // keep the response map of the search window of each frame (see getResponseMap)
     };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1179,7 +1472,8 @@ namespace cv
     public:
       SimpleTracker()
           :
-            _cnt(0)
+            _cnt(0),
+            _scale(1.0f)
       {
       }
       ~SimpleTracker()
@@ -1203,13 +1497,47 @@ namespace cv
         roi.x = cvRound(_curState[0]);
         roi.y = cvRound(_curState[1]);
       }
+      // Classifier response over the search window of the last frame, (2 * _srchwinsz + 1) pixels wide and high
+      // and reused from frame to frame: element (r, c) is the response (probability or log odds ratio, see
+      // _useLogR) of the box whose top left corner is at getResponseOrigin() + (c, r) in the frame, the best of
+      // the scales when searching several. Locations that were not evaluated hold -FLT_MAX.
+      // Empty unless _storeResponse (or _debugv) is set.
+      const cv::Mat_<float> &
+      getResponseMap() const
+      {
+        return _respMap;
+      }
+      cv::Point
+      getResponseOrigin() const
+      {
+        return _respOrigin;
+      }
 
     private:
+      // classifies the candidates of _detectx at each of _trparams._scales; all of them end up in _detectx, _prob
+      void
+      searchScales(const cv::Mat & img, const IntegralImage & ii);
+      // fills _respMap from the responses of the candidates around (x, y)
+      void
+      storeResponse(int x, int y);
+
       cv::Ptr<ClfStrong> _clf;
       vectorf _curState;
       SimpleTrackerParams _trparams;
       cv::Ptr<ClfStrongParams> _clfparams;
       int _cnt;
+      float _scale; // size of the box relative to the feature patch
+      RandomStream _rng; // sampling, stream 1 of _trparams._seed
+      // per frame scratch, kept across frames: no state is shared between trackers
+      IntegralImage _ii;
+      SampleSet _posx, _negx, _detectx;
+      std::vector<SampleSet> _scalex; // [scale]
+      vectorf _prob;
+      std::vector<vectorf> _scaleprob; // [scale][sample]
+      std::vector<vectori> _scalecand; // [scale][sample] candidate location it was scaled from
+      std::vector<cv::Point> _candidate; // [sample of _detectx] top left corner of that candidate location
+      cv::Mat_<float> _respMap;
+      cv::Point _respOrigin;
     };
 
   } // namespace mil
@@ -0,0 +1,450 @@
+// Integral images and multi-rectangle Haar features shared by the trackers: Compressive Tracking
+// (../RCT/c++), MIL and the online boosting (cv_onlineboosting and ../BoostingTracker/FRAMEWORK).
+// Header only and free of OpenCV, so that each tracker keeps its own image types.
+
+#ifndef __HAAR_FEATURES_H__
+#define __HAAR_FEATURES_H__
+
+#include <assert.h>
+#include <stddef.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAAR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace haar
+{
+  //---------------------------------------------------------------------------
+  // Integral images
+  //
+  // sum is (height + 1) x (width + 1) with rows sum_step elements apart, a zero first row and a zero
+  // first column: sum(y, x) is the sum of the pixels of image(0..y-1, 0..x-1). Each row is a SIMD
+  // prefix sum of the pixels (in 32 bits: exact for widths up to 2^32 / 255^2 with the squares)
+  // followed by a column pass adding the row above.
+
+  namespace detail
+  {
+#ifdef HAAR_SSE2
+    // Stores the inclusive prefix sum of the four lanes of v plus carry; returns the last sum in all lanes
+    inline __m128i
+    scan4(__m128i v, __m128i carry, unsigned int* prefix)
+    {
+      v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+      v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+      v = _mm_add_epi32(v, carry);
+      _mm_storeu_si128((__m128i *) prefix, v);
+      return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    // Stores the prefix sums of the 16 values of v8 (16-bit lanes lo16, hi16) plus carry
+    inline __m128i
+    scan16(__m128i lo16, __m128i hi16, __m128i carry, unsigned int* prefix)
+    {
+      const __m128i zero = _mm_setzero_si128();
+      carry = scan4(_mm_unpacklo_epi16(lo16, zero), carry, prefix);
+      carry = scan4(_mm_unpackhi_epi16(lo16, zero), carry, prefix + 4);
+      carry = scan4(_mm_unpacklo_epi16(hi16, zero), carry, prefix + 8);
+      return scan4(_mm_unpackhi_epi16(hi16, zero), carry, prefix + 12);
+    }
+#endif
+
+    // prefix[x] = image[0] + ... + image[x]
+    inline void
+    row_prefix(const unsigned char* image, int width, unsigned int* prefix)
+    {
+      int x = 0;
+      unsigned int s = 0;
+#ifdef HAAR_SSE2
+      const __m128i zero = _mm_setzero_si128();
+      __m128i carry = zero;
+      for (; x + 16 <= width; x += 16)
+      {
+        __m128i v = _mm_loadu_si128((const __m128i *) (image + x));
+        carry = scan16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero), carry, prefix + x);
+      }
+      s = (unsigned int) _mm_cvtsi128_si32(carry);
+#endif
+      for (; x < width; x++)
+        prefix[x] = s += image[x];
+    }
+
+    // The same with sq_prefix[x] = image[0]^2 + ... + image[x]^2
+    inline void
+    row_prefix(const unsigned char* image, int width, unsigned int* prefix, unsigned int* sq_prefix)
+    {
+      int x = 0;
+      unsigned int s = 0, sq = 0;
+#ifdef HAAR_SSE2
+      const __m128i zero = _mm_setzero_si128();
+      __m128i carry = zero, sq_carry = zero;
+      for (; x + 16 <= width; x += 16)
+      {
+        __m128i v = _mm_loadu_si128((const __m128i *) (image + x));
+        __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+        carry = scan16(lo, hi, carry, prefix + x);
+        // 255^2 still fits in an unsigned 16-bit lane
+        sq_carry = scan16(_mm_mullo_epi16(lo, lo), _mm_mullo_epi16(hi, hi), sq_carry, sq_prefix + x);
+      }
+      s = (unsigned int) _mm_cvtsi128_si32(carry);
+      sq = (unsigned int) _mm_cvtsi128_si32(sq_carry);
+#endif
+      for (; x < width; x++)
+      {
+        prefix[x] = s += image[x];
+        sq_prefix[x] = sq += (unsigned int) image[x] * image[x];
+      }
+    }
+
+    // row[x + 1] = above[x + 1] + prefix[x]
+    template<typename T>
+    inline void
+    column_pass(const unsigned int* prefix, int width, const T* above, T* row)
+    {
+      for (int x = 0; x < width; x++)
+        row[x + 1] = above[x + 1] + (T) prefix[x];
+    }
+
+#ifdef HAAR_SSE2
+    template<>
+    inline void
+    column_pass<float>(const unsigned int* prefix, int width, const float* above, float* row)
+    {
+      int x = 0;
+      for (; x + 4 <= width; x += 4)
+      {
+        __m128 s = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (prefix + x)));
+        _mm_storeu_ps(row + x + 1, _mm_add_ps(_mm_loadu_ps(above + x + 1), s));
+      }
+      for (; x < width; x++)
+        row[x + 1] = above[x + 1] + (float) prefix[x];
+    }
+
+    template<>
+    inline void
+    column_pass<unsigned int>(const unsigned int* prefix, int width, const unsigned int* above, unsigned int* row)
+    {
+      int x = 0;
+      for (; x + 4 <= width; x += 4)
+      {
+        __m128i s = _mm_loadu_si128((const __m128i *) (prefix + x));
+        _mm_storeu_si128((__m128i *) (row + x + 1), _mm_add_epi32(_mm_loadu_si128((const __m128i *) (above + x + 1)), s));
+      }
+      for (; x < width; x++)
+        row[x + 1] = above[x + 1] + prefix[x];
+    }
+
+    template<>
+    inline void
+    column_pass<int>(const unsigned int* prefix, int width, const int* above, int* row)
+    {
+      column_pass<unsigned int>(prefix, width, (const unsigned int*) above, (unsigned int*) row);
+    }
+#endif
+
+    // magnitude[x] = (|dx| + |dy| + 1) / 2 at pixel x of row, maximum over the channels (central differences,
+    // replicated borders: above and below are row itself at the first and last rows)
+    inline void
+    gradient_row(const unsigned char* above, const unsigned char* row, const unsigned char* below, int width,
+                 int channels, unsigned char* magnitude)
+    {
+      for (int x = 0; x < width; x++)
+      {
+        const int left = (x > 0 ? x - 1 : x) * channels, right = (x + 1 < width ? x + 1 : x) * channels;
+        const int center = x * channels;
+        int m = 0;
+        for (int c = 0; c < channels; c++)
+        {
+          int dx = row[right + c] - row[left + c];
+          int dy = below[center + c] - above[center + c];
+          int g = ((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy) + 1) >> 1;
+          if (g > m)
+            m = g;
+        }
+        magnitude[x] = (unsigned char) m;
+      }
+    }
+
+    // prefix[x * out + c] = image[0][c] + ... + image[x][c], with out = channels (+ 1 for the magnitude channel)
+    inline void
+    interleaved_prefix(const unsigned char* image, const unsigned char* magnitude, int width, int channels,
+                       unsigned int* prefix)
+    {
+      if (channels == 1 && !magnitude)
+      {
+        row_prefix(image, width, prefix);
+        return;
+      }
+      const int out = channels + (magnitude ? 1 : 0);
+      for (int c = 0; c < channels; c++)
+      {
+        unsigned int s = 0;
+        for (int x = 0; x < width; x++)
+          prefix[x * out + c] = s += image[x * channels + c];
+      }
+      if (magnitude)
+      {
+        unsigned int s = 0;
+        for (int x = 0; x < width; x++)
+          prefix[x * out + channels] = s += magnitude[x];
+      }
+    }
+  }
+
+  // Integral image of an 8-bit single channel image
+  template<typename T>
+  void
+  integral(const unsigned char* image, int width, int height, int image_step, T* sum, int sum_step)
+  {
+    for (int x = 0; x <= width; x++)
+      sum[x] = 0;
+    if (width <= 0)
+    {
+      for (int y = 1; y <= height; y++)
+        sum[y * sum_step] = 0;
+      return;
+    }
+
+    std::vector<unsigned int> prefix(width);
+    for (int y = 0; y < height; y++)
+    {
+      T* row = sum + (size_t) (y + 1) * sum_step;
+      row[0] = 0;
+      detail::row_prefix(image + (size_t) y * image_step, width, &prefix[0]);
+      detail::column_pass(&prefix[0], width, row - sum_step, row);
+    }
+  }
+
+  // Integral image and integral of the squared pixels
+  template<typename T, typename Q>
+  void
+  integral(const unsigned char* image, int width, int height, int image_step, T* sum, int sum_step, Q* sqsum,
+           int sqsum_step)
+  {
+    for (int x = 0; x <= width; x++)
+    {
+      sum[x] = 0;
+      sqsum[x] = 0;
+    }
+    if (width <= 0)
+    {
+      for (int y = 1; y <= height; y++)
+      {
+        sum[y * sum_step] = 0;
+        sqsum[y * sqsum_step] = 0;
+      }
+      return;
+    }
+
+    std::vector<unsigned int> prefix(2 * width);
+    for (int y = 0; y < height; y++)
+    {
+      T* row = sum + (size_t) (y + 1) * sum_step;
+      Q* sq_row = sqsum + (size_t) (y + 1) * sqsum_step;
+      row[0] = 0;
+      sq_row[0] = 0;
+      detail::row_prefix(image + (size_t) y * image_step, width, &prefix[0], &prefix[width]);
+      detail::column_pass(&prefix[0], width, row - sum_step, row);
+      detail::column_pass(&prefix[width], width, sq_row - sqsum_step, sq_row);
+    }
+  }
+
+  // Interleaved integral images of an 8-bit image with interleaved channels, in one pass over the image.
+  // With out = channels (+ 1 when gradient is set), the integral of channel c at (y, x) is
+  // sum[y * sum_step + x * out + c]; the extra last channel is the integral of the gradient magnitude (see
+  // detail::gradient_row). sum is (height + 1) x (width + 1) * out.
+  template<typename T>
+  void
+  integral_channels(const unsigned char* image, int width, int height, int image_step, int channels, bool gradient,
+                    T* sum, int sum_step)
+  {
+    const int out = channels + (gradient ? 1 : 0);
+    for (int x = 0; x < (width + 1) * out; x++)
+      sum[x] = 0;
+    if (width <= 0)
+    {
+      for (int y = 1; y <= height; y++)
+        for (int c = 0; c < out; c++)
+          sum[y * sum_step + c] = 0;
+      return;
+    }
+
+    std::vector<unsigned int> prefix(width * out);
+    std::vector<unsigned char> magnitude(gradient ? width : 0);
+    for (int y = 0; y < height; y++)
+    {
+      const unsigned char* image_row = image + (size_t) y * image_step;
+      T* row = sum + (size_t) (y + 1) * sum_step;
+      for (int c = 0; c < out; c++)
+        row[c] = 0;
+      if (gradient)
+        detail::gradient_row(y > 0 ? image_row - image_step : image_row, image_row,
+                             y + 1 < height ? image_row + image_step : image_row, width, channels, &magnitude[0]);
+      detail::interleaved_prefix(image_row, gradient ? &magnitude[0] : NULL, width, channels, &prefix[0]);
+      // row[out + i] = above[out + i] + prefix[i]
+      detail::column_pass(&prefix[0], width * out, row - sum_step + out - 1, row + out - 1);
+    }
+  }
+
+  // Sum of the pixels of the rectangle (x, y, width, height)
+  template<typename T>
+  inline T
+  rect_sum(const T* sum, int sum_step, int x, int y, int width, int height)
+  {
+    const T* top = sum + (size_t) y * sum_step + x;
+    const T* bottom = top + (size_t) height * sum_step;
+    return bottom[width] + top[0] - bottom[0] - top[width];
+  }
+
+  // The same in interleaved integral images of `channels` channels, sum pointing at the channel
+  template<typename T>
+  inline T
+  rect_sum(const T* sum, int sum_step, int channels, int x, int y, int width, int height)
+  {
+    const T* top = sum + (size_t) y * sum_step + x * channels;
+    const T* bottom = top + (size_t) height * sum_step;
+    return bottom[width * channels] + top[0] - bottom[0] - top[width * channels];
+  }
+
+  //---------------------------------------------------------------------------
+  // Multi-rectangle features
+  //
+  // A feature is a weighted sum of rectangle sums over one channel. Once compiled for the row stride (and
+  // channel count, for interleaved integral images) every rectangle is four offsets from the sample
+  // origin, the channel included, and the features are evaluated over a batch of sample origins at a time.
+
+  class FeatureTable
+  {
+  public:
+    FeatureTable()
+        :
+          _step(0),
+          _channels(0)
+    {
+      _begin.push_back(0);
+    }
+
+    void
+    clear()
+    {
+      _rects.clear();
+      _begin.assign(1, 0);
+      _channel.clear();
+      _step = 0;
+      _channels = 0;
+    }
+
+    // Starts a new feature over the given channel: the rectangles added next belong to it
+    void
+    add_feature(int channel = 0)
+    {
+      _begin.push_back((int) _rects.size());
+      _channel.push_back(channel);
+    }
+
+    // Adds the rectangle (x, y, width, height), relative to the sample origin, to the last feature
+    void
+    add_rect(int x, int y, int width, int height, float weight)
+    {
+      assert(num_features() > 0);
+      Rect r;
+      r.x = x;
+      r.y = y;
+      r.width = width;
+      r.height = height;
+      r.weight = weight;
+      r.channel = _channel.back();
+      r.tl = r.tr = r.bl = r.br = 0;
+      _rects.push_back(r);
+      _begin.back() = (int) _rects.size();
+      _step = 0;
+    }
+
+    int
+    num_features() const
+    {
+      return (int) _begin.size() - 1;
+    }
+
+    int
+    num_rects() const
+    {
+      return (int) _rects.size();
+    }
+
+    // Corner offsets for integral images with rows sum_step elements apart and `channels` interleaved channels
+    void
+    compile(int sum_step, int channels = 1)
+    {
+      if (sum_step == _step && channels == _channels)
+        return;
+      for (size_t k = 0; k < _rects.size(); k++)
+      {
+        Rect& r = _rects[k];
+        assert(r.channel < channels);
+        r.tl = r.y * sum_step + r.x * channels + r.channel;
+        r.tr = r.tl + r.width * channels;
+        r.bl = r.tl + r.height * sum_step;
+        r.br = r.bl + r.width * channels;
+      }
+      _step = sum_step;
+      _channels = channels;
+    }
+
+    // Offset of the sample origin (x, y) in the integral image the table is compiled for
+    int
+    offset(int x, int y) const
+    {
+      return y * _step + x * _channels;
+    }
+
+    // values[s] = feature at the sample whose origin is sum + offsets[s]
+    template<typename T>
+    void
+    evaluate(int feature, const T* sum, const int* offsets, int num_samples, float* values) const
+    {
+      assert(_step > 0 && feature >= 0 && feature < num_features());
+      for (int s = 0; s < num_samples; s++)
+        values[s] = 0.0f;
+      // one rectangle over all the samples at a time: the corner offsets stay in registers
+      for (int k = _begin[feature]; k < _begin[feature + 1]; k++)
+      {
+        const Rect& r = _rects[k];
+        const int tl = r.tl, tr = r.tr, bl = r.bl, br = r.br;
+        const float weight = r.weight;
+        for (int s = 0; s < num_samples; s++)
+        {
+          const T* p = sum + offsets[s];
+          values[s] += weight * (float) (p[br] + p[tl] - p[bl] - p[tr]);
+        }
+      }
+    }
+
+    // values[f * values_step + s] for every feature f
+    template<typename T>
+    void
+    evaluate(const T* sum, const int* offsets, int num_samples, float* values, size_t values_step) const
+    {
+      for (int f = 0; f < num_features(); f++)
+        evaluate(f, sum, offsets, num_samples, values + f * values_step);
+    }
+
+  private:
+    struct Rect
+    {
+      int x, y, width, height;
+      float weight;
+      int channel;
+      int tl, tr, bl, br;
+    };
+
+    std::vector<Rect> _rects;
+    std::vector<int> _begin;  // the rectangles of feature f are [_begin[f], _begin[f + 1])
+    std::vector<int> _channel;  // [feature]
+    int _step;
+    int _channels;
+  };
+}
+
+#endif  // #ifndef __HAAR_FEATURES_H__
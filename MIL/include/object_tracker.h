@@ -44,6 +44,9 @@
 #define __OPENCV_OBJECT_TRACKER_H__
 
 #include <opencv2/core/core.hpp>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "cv_onlineboosting.h"
 #include "cv_onlinemil.h"
@@ -63,14 +66,15 @@ namespace cv
   {
     enum
     {
-      CV_ONLINEBOOSTING = 100, CV_SEMIONLINEBOOSTING, CV_ONLINEMIL, CV_LINEMOD
+      CV_ONLINEBOOSTING = 100, CV_SEMIONLINEBOOSTING, CV_ONLINEMIL, CV_LINEMOD, CV_TLD, CV_CT, CV_BEYONDSEMIBOOSTING
     };
 
     ObjectTrackerParams();
     ObjectTrackerParams(const int algorithm, const int num_classifiers, const float overlap, const float search_factor,
                         const float pos_radius_train, const int neg_num_train, const int num_features);
 
-    int algorithm_; // CV_ONLINEBOOSTING, CV_SEMIONLINEBOOSTING, CV_ONLINEMIL, CV_LINEMOD
+    int algorithm_; // CV_ONLINEBOOSTING, CV_SEMIONLINEBOOSTING, CV_ONLINEMIL, CV_LINEMOD, CV_TLD, CV_CT,
+                    // CV_BEYONDSEMIBOOSTING
     int num_classifiers_; // the number of classifiers to use in a given boosting algorithm (OnlineBoosting, MIL)
     float overlap_; // search region parameters to use in a given boosting algorithm (OnlineBoosting, MIL)
     float search_factor_; // search region parameters to use in a given boosting algorithm (OnlineBoosting, MIL)
@@ -79,6 +83,10 @@ namespace cv
     float pos_radius_train_; // radius for gathering positive instances
     int neg_num_train_; // # negative samples to use during training
     int num_features_;
+    int64 seed_; // seed of the random streams of a tracker; negative for a different run each time (time(0))
+
+    // Parameter file of algorithms configured from YAML (TLD's parameters.yml); built-in defaults if empty
+    std::string config_file_;
   };
 
   //
@@ -100,10 +108,21 @@ namespace cv
     virtual bool
     update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box) = 0;
 
+    // Time (ms) spent in the internal stages of the last initialize() or update(), for the
+    // algorithms that measure them (none by default)
+    virtual void
+    stage_times(std::vector<std::pair<std::string, float> > & stages) const;
+
+    // Converts an RGB, RGBA or gray 8-bit image to gray-scale.  Gray input is shared, not
+    // copied, so a frame converted once can be handed to any number of algorithms.
+    static void
+    import_gray(const cv::Mat & image, cv::Mat & gray);
+
   protected:
     // A method to import an image to the type desired for the current algorithm
+    // (8-bit gray-scale through import_gray() unless overridden)
     virtual void
-    import_image(const cv::Mat & image) = 0;
+    import_image(const cv::Mat & image);
 
     // A local image holder (can be gray-scale, color, depth image 16-bit, whatever
     // you want...)
@@ -114,6 +133,39 @@ namespace cv
   //
   //
 
+  // Tracking algorithms by name, so that a tracker can be chosen per stream at run-time.
+  // Built in: "onlineboosting", "semionlineboosting", "beyondsemiboosting", "mil" and "linemod"; "tld" and "ct"
+  // when the library is built with WITH_TLD / WITH_CT.  Other algorithms can be added with add().
+  CV_EXPORTS class TrackingAlgorithmRegistry
+  {
+  public:
+    typedef TrackingAlgorithm*
+    (*Factory)();
+
+    // Register (or replace) an algorithm
+    static void
+    add(const std::string & name, Factory factory);
+
+    // A new instance of the named algorithm, NULL if unknown
+    static TrackingAlgorithm*
+    create(const std::string & name);
+
+    static std::vector<std::string>
+    names();
+
+    // Registry name of an ObjectTrackerParams algorithm flag ("" if unknown)
+    static std::string
+    name_of(int algorithm);
+
+  private:
+    static std::map<std::string, Factory>&
+    factories();
+  };
+
+  //
+  //
+  //
+
   // A speficic instance of a tracking algorithm: Online Boosting as described
   // in the following paper:
   //
@@ -132,11 +184,6 @@ namespace cv
     virtual bool
     update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box);
 
-  protected:
-    // A method to import an image to the type desired for the current algorithm
-    virtual void
-    import_image(const cv::Mat & image);
-
   private:
     // The main boosting tracker object
     boosting::BoostingTracker* tracker_;
@@ -174,11 +221,6 @@ namespace cv
     virtual bool
     update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box);
 
-  protected:
-    // A method to import an image to the type desired for the current algorithm
-    virtual void
-    import_image(const cv::Mat & image);
-
   private:
     // The main boosting tracker object
     boosting::SemiBoostingTracker* tracker_;
@@ -215,11 +257,6 @@ namespace cv
     virtual bool
     update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box);
 
-  protected:
-    // A method to import an image to the type desired for the current algorithm
-    virtual void
-    import_image(const cv::Mat & image);
-
   private:
     // The main Online MIL tracker
     cv::mil::SimpleTracker tracker_;
@@ -279,6 +316,9 @@ namespace cv
     //
     ObjectTracker(const ObjectTrackerParams& params = ObjectTrackerParams());
 
+    // Same, with the algorithm given by its TrackingAlgorithmRegistry name (params.algorithm_ is ignored)
+    ObjectTracker(const std::string & algorithm, const ObjectTrackerParams& params = ObjectTrackerParams());
+
     // Destructor--performs cleanup of memory 
     virtual
     ~ObjectTracker();
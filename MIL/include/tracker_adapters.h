@@ -0,0 +1,164 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//                For Open Source Computer Vision Library
+//
+// Copyright (C) 2000-2008, Intel Corporation, all rights reserved.
+// Copyright (C) 2009-2011, Willow Garage Inc., all rights reserved.
+// Third party copyrights are property of their respective owners.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//   * Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//   * Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   * The name of the copyright holders may not be used to endorse or promote products
+//     derived from this software without specific prior written permission.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the Intel Corporation or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+//
+//M*/
+
+#ifndef __OPENCV_TRACKER_ADAPTERS_H__
+#define __OPENCV_TRACKER_ADAPTERS_H__
+
+// Adapters for the trackers of the collection that have their own API, so that
+// they can be created through the TrackingAlgorithmRegistry.  TLD and CT are compiled
+// in only when the library is built with them (WITH_TLD / WITH_CT).
+
+#include "object_tracker.h"
+
+#ifdef HAVE_TLD
+#include <TLD.h>
+#endif
+#ifdef HAVE_CT
+#include <CompressiveTracker.h>
+#endif
+
+namespace cv
+{
+  // Beyond Semi-Supervised Tracking, the third tracker of BoostingTracker/FRAMEWORK,
+  // ported to cv::boosting:
+  //
+  // S. Stalder, H. Grabner, and L. Van Gool.  "Beyond Semi-Supervised Tracking: Tracking
+  // Should Be as Simple as Detection, but not Simpler than Recognition", ICCV Workshops 2009.
+  //
+  // As in BeyondSemiBoostingApplication, the adapter keeps the background model the tracker
+  // learns against: the first frame with the object covered, then every frame outside the
+  // box of the last successful track.
+  //
+  CV_EXPORTS class BeyondSemiBoostingAlgorithm: public TrackingAlgorithm
+  {
+  public:
+    BeyondSemiBoostingAlgorithm();
+    ~BeyondSemiBoostingAlgorithm();
+
+    virtual bool
+    initialize(const cv::Mat & image, const ObjectTrackerParams& params, const CvRect& init_bounding_box);
+
+    virtual bool
+    update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box);
+
+  private:
+    // The tracker and the image representations of the frame and of the background
+    cv::Ptr<boosting::BeyondSemiBoostingTracker> tracker_;
+    cv::Ptr<boosting::ImageRepresentation> cur_frame_rep_;
+    cv::Ptr<boosting::ImageRepresentation> background_rep_;
+
+    // Background model (gray, frame sized)
+    cv::Mat background_;
+
+    // Size of the tracked object
+    cv::Size tracking_rect_size_;
+
+    // Whether or not the tracker was lost on the last frame (the next one is searched whole)
+    bool tracker_lost_;
+  };
+
+
+#ifdef HAVE_TLD
+  // TLD (Tracking-Learning-Detection), from TLD/c++.  The parameters are read from
+  // ObjectTrackerParams::config_file_ (a TLD parameters.yml) or default to the ones
+  // shipped with TLD.  TLD learns on the calling thread and opens no window, so the
+  // adapter runs headless; the examples window is shown only by TLD/c++'s run_tld.
+  //
+  CV_EXPORTS class TLDAlgorithm: public TrackingAlgorithm
+  {
+  public:
+    TLDAlgorithm();
+    ~TLDAlgorithm();
+
+    virtual bool
+    initialize(const cv::Mat & image, const ObjectTrackerParams& params, const CvRect& init_bounding_box);
+
+    virtual bool
+    update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box);
+
+    // Stage timers of the last frame; recorded only when TLD is built with TLD_METRICS
+    virtual void
+    stage_times(std::vector<std::pair<std::string, float> > & stages) const;
+
+  private:
+    // The TLD framework
+    TLD tld_;
+
+    // TLD tracks between consecutive frames, so it keeps its own copy of the last one
+    cv::Mat last_gray_;
+
+    // Whether or not the object was found on the last frame
+    bool found_;
+  };
+#endif
+
+#ifdef HAVE_CT
+  // Compressive Tracking, from RCT/c++:
+  //
+  // K. Zhang, L. Zhang, and M.-H. Yang.  "Real-Time Compressive Tracking",
+  // In Proceedings European Conference on Computer Vision (ECCV), 2012.
+  //
+  CV_EXPORTS class CTAlgorithm: public TrackingAlgorithm
+  {
+  public:
+    CTAlgorithm();
+    ~CTAlgorithm();
+
+    virtual bool
+    initialize(const cv::Mat & image, const ObjectTrackerParams& params, const CvRect& init_bounding_box);
+
+    virtual bool
+    update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box);
+
+  private:
+    // The compressive tracker object
+    CompressiveTracker tracker_;
+
+    // The current object box, updated in place by the tracker
+    cv::Rect box_;
+  };
+#endif
+
+}
+
+#endif  // #ifndef __OPENCV_TRACKER_ADAPTERS_H__
+/* End of file. */
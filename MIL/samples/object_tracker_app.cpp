@@ -21,8 +21,10 @@ main(int argc, char** argv)
   params.num_features_ = 250;
 #endif
 
-  // Instantiate an object tracker
-  cv::ObjectTracker tracker(params);
+  // Instantiate an object tracker, optionally choosing the algorithm by name
+  // (see cv::TrackingAlgorithmRegistry::names())
+  cv::ObjectTracker tracker(argc > 1 ? std::string(argv[1]) : cv::TrackingAlgorithmRegistry::name_of(params.algorithm_),
+                            params);
 
   // Read in a sequence of images from disk as the video source
   const char* directory = "data/david";
@@ -185,8 +185,8 @@ namespace cv
       if (OriginY + Height >= m_ROI.height)
         Height = m_ROI.height - OriginY;
 
-      long int value = intSqImage(OriginY + Height, OriginX + Width) + intSqImage(OriginY, OriginX)
-          - intSqImage(OriginY, OriginX + Width) - intSqImage(OriginY + Height, OriginX);
+      long int value = haar::rect_sum((const double*) intSqImage.data, (int) intSqImage.step1(), OriginX, OriginY, Width,
+                                      Height);
 
       assert(value >= 0);
 
@@ -225,8 +225,7 @@ namespace cv
       if (OriginY + Height >= m_ROI.height)
         Height = m_ROI.height - OriginY;
 
-      int value = intImage(OriginY + Height, OriginX + Width) + intImage(OriginY, OriginX)
-          - intImage(OriginY, OriginX + Width) - intImage(OriginY + Height, OriginX);
+      int value = haar::rect_sum((const int*) intImage.data, (int) intImage.step1(), OriginX, OriginY, Width, Height);
 
       return value;
     }
@@ -253,7 +252,15 @@ namespace cv
     void
     ImageRepresentation::createIntegralsOfROI(const cv::Mat & image)
     {
-      cv::integral(image(m_ROI), intImage, intSqImage, CV_32S);
+      if (image.type() != CV_8UC1)
+      {
+        cv::integral(image(m_ROI), intImage, intSqImage, CV_32S);
+        return;
+      }
+      intImage.create(m_ROI.height + 1, m_ROI.width + 1);
+      intSqImage.create(m_ROI.height + 1, m_ROI.width + 1);
+      haar::integral(image.ptr<unsigned char>(m_ROI.y) + m_ROI.x, m_ROI.width, m_ROI.height, (int) image.step,
+                     (int*) intImage.data, (int) intImage.step1(), (double*) intSqImage.data, (int) intSqImage.step1());
     }
 
     Patches::Patches(void)
@@ -2353,6 +2360,321 @@ namespace cv
       return center;
     }
 
+    BeyondSemiBoostingTracker::BeyondSemiBoostingTracker(ImageRepresentation* image,
+                                                         ImageRepresentation* backgroundImage, Rect initPatch,
+                                                         Rect validROI, int numBaseClassifier)
+    {
+      offThreshold = -100;
+
+      this->validROI = validROI;
+      this->numBaseClassifier = numBaseClassifier;
+      int numWeakClassifier = 100;
+      bool useFeatureExchange = true;
+      int iterationInit = 50;
+      Size patchSize(initPatch.width, initPatch.height);
+
+      classifierOff = new StrongClassifierStandardSemi(numBaseClassifier, numWeakClassifier, patchSize,
+                                                       useFeatureExchange, iterationInit);
+      classifierOn = new StrongClassifierStandardSemi(numBaseClassifier, numWeakClassifier, patchSize,
+                                                      useFeatureExchange, iterationInit);
+      classifier = new StrongClassifierStandardSemi(numBaseClassifier, numWeakClassifier, patchSize, useFeatureExchange,
+                                                    iterationInit);
+
+      trackedPatch = initPatch;
+
+      //train the off-line "detector"
+      Rect trackingROI = getTrackingROI(2.0f);
+      Size trackedPatchSize(trackedPatch.width, trackedPatch.height);
+      Patches* trackingPatches = new PatchesRegularScan(trackingROI, validROI, trackedPatchSize, 0.99f);
+      iterationInit = 25;
+      for (int curInitStep = 0; curInitStep < iterationInit; curInitStep++)
+      {
+        std::cout << "\rinit tracker... " << int(((float) curInitStep) / (iterationInit - 1) * 100) << " %%";
+        initClassifier(initPatch, image, trackingPatches, true, true, true);
+      }
+      delete trackingPatches;
+      std::cout << " done." << std::endl << "init detector... ";
+
+      //also scan on the whole image to make a "better" detector
+      Patches* patches = new PatchesRegularScan(validROI, validROI, patchSize, 0.95f);
+      initClassifierOff(initPatch, image, backgroundImage, patches);
+      delete patches;
+      std::cout << " done." << std::endl;
+
+      confidence = 1;
+    }
+
+    // one labeled round: each corner of the search region as negative, the object as positive
+    static void
+    updateCorners(StrongClassifierStandardSemi & classifier, ImageRepresentation* image, Patches* patches,
+                  Rect initPatch)
+    {
+      static const char* corners[] =
+      { "UpperLeft", "UpperRight", "LowerLeft", "LowerRight" };
+      for (int k = 0; k < 4; k++)
+      {
+        classifier.updateSemi(image, patches->getSpecialRect(corners[k]), -1);
+        classifier.updateSemi(image, initPatch, 1);
+      }
+    }
+
+    void
+    BeyondSemiBoostingTracker::initClassifier(Rect initPatch, ImageRepresentation* image, Patches* patches,
+                                              bool offUpdate, bool onUpdate, bool classifierUpdate)
+    {
+      if (classifierUpdate)
+        updateCorners(*classifier, image, patches, initPatch);
+      if (offUpdate)
+        updateCorners(*classifierOff, image, patches, initPatch);
+      if (onUpdate)
+        updateCorners(*classifierOn, image, patches, initPatch);
+    }
+
+    void
+    BeyondSemiBoostingTracker::initClassifierOff(Rect initPatch, ImageRepresentation* image,
+                                                 ImageRepresentation* BGMRep, Patches *patches)
+    {
+      //train the detector with the most similar patches from the image
+      std::vector<int> posSamples;
+      float sumAlpha = classifierOff->getSumAlpha();
+      float threshold = 0.0f;
+      float tmpConf = 0.0f;
+      float tmpConfBGM = 0.0f;
+      float tmpConfMax = -1.0f;
+      float tmpConfBGMMax = -1.0f;
+
+      while ((tmpConfBGMMax > threshold && tmpConfMax > threshold) || tmpConfBGMMax == -1.0f)
+      {
+        threshold = threshold + 0.05f;
+        posSamples.clear();
+        tmpConfBGMMax = -1;
+        for (int i = 0; i < patches->getNum(); i++)
+        {
+          tmpConfBGM = classifierOff->eval(BGMRep, patches->getRect(i)) / sumAlpha;
+          if (tmpConfBGM >= threshold)
+            posSamples.push_back(i);
+          if (tmpConfBGM > tmpConfBGMMax)
+            tmpConfBGMMax = tmpConfBGM;
+        }
+
+        for (size_t k = 0; k < posSamples.size(); k++)
+        {
+          classifierOff->updateSemi(image, initPatch, 1);
+          classifierOff->updateSemi(BGMRep, patches->getRect(posSamples[k]), -1);
+        }
+
+        //verification
+        tmpConfBGMMax = -100.0f;
+        tmpConfMax = -100.0f;
+        sumAlpha = classifierOff->getSumAlpha();
+        for (int i = 0; i < patches->getNum(); i++)
+        {
+          tmpConfBGM = classifierOff->eval(BGMRep, patches->getRect(i)) / sumAlpha;
+          tmpConf = classifierOff->eval(image, patches->getRect(i)) / sumAlpha;
+          if (tmpConfBGM > tmpConfBGMMax)
+            tmpConfBGMMax = tmpConfBGM;
+          if (tmpConf > tmpConfMax)
+            tmpConfMax = tmpConf;
+        }
+      }
+
+      offThreshold = (tmpConfMax + tmpConfBGMMax) / 2;
+    }
+
+    bool
+    BeyondSemiBoostingTracker::updateOn(ImageRepresentation* image, ImageRepresentation* BGMRep, Patches* patches)
+    {
+      //SUPERVISED UPDATES of the recognizer, on the image and the background image
+      static const char* corners[] =
+      { "UpperLeft", "UpperRight", "LowerLeft", "LowerRight" };
+      for (int k = 0; k < 4; k++)
+      {
+        classifierOn->updateSemi(image, patches->getSpecialRect(corners[k]), -1);
+        classifierOn->updateSemi(image, trackedPatch, 1);
+        classifierOn->updateSemi(BGMRep, trackedPatch, -1);
+        classifierOn->updateSemi(image, trackedPatch, 1);
+      }
+
+      //now, we have to make sure that the classifier really distinguished FG from BG
+      //e.g. that the tracker does not jump in the BG
+      std::vector<int> posSamples;
+      for (int i = 0; i < patches->getNum(); i++)
+      {
+        float confOn = classifierOn->eval(BGMRep, patches->getRect(i)) / classifierOn->getSumAlpha();
+        if (confOn >= 0.1f)
+          posSamples.push_back(i);
+      }
+      for (size_t k = 0; k < posSamples.size(); k++)
+      {
+        classifierOn->updateSemi(image, trackedPatch, 1);
+        classifierOn->updateSemi(BGMRep, patches->getRect(posSamples[k]), -1);
+      }
+
+      return true;
+    }
+
+    bool
+    BeyondSemiBoostingTracker::update(ImageRepresentation* image, ImageRepresentation* BGMRep, Patches* patches)
+    {
+      //UNSUPERVISED UPDATES of the tracking classifier in the FG
+      //SUPERVISED UPDATES of the tracking classifier in the BG
+      //ANALYSIS OF THE CONFIDENCE MAP: updates at the position of the supposed maximum,
+      //the maximum needs to remain at that position
+      std::vector<int> maxIVector;
+      bool checkMaxI = false;
+      float maxConf = -100;
+      int maxI = 0;
+      int iterCounter = 0;
+      while (checkMaxI == false && iterCounter < 10 && (maxConf > 0.1f || iterCounter == 0))
+      {
+        iterCounter++;
+        maxConf = -100;
+        for (int i = 0; i < patches->getNum(); i++)
+        {
+          float tempConf = classifier->eval(image, patches->getRect(i)) / classifier->getSumAlpha();
+          if (tempConf > maxConf)
+          {
+            maxConf = tempConf;
+            maxI = i;
+          }
+        }
+
+        //supposed maximum is found, perform unlabeled updates only if maxConf is higher than threshold
+        if (maxConf > 0.1f)
+        {
+          float confOn = classifierOn->eval(image, patches->getRect(maxI)) / classifierOn->getSumAlpha();
+          classifier->updateSemi(BGMRep, patches->getRect(maxI), -1);
+          classifier->updateSemi(image, patches->getRect(maxI), confOn);
+        }
+
+        maxIVector.push_back(maxI);
+        if (maxIVector.size() > 1 && maxIVector[maxIVector.size() - 2] == maxI)
+          checkMaxI = true;
+      }
+
+      //if the confidence of the supposed maximum is lower than threshold, the track is lost
+      if (maxConf < 0.1f || iterCounter >= 10)
+      {
+        confidence = 0;
+        return false;
+      }
+
+      confidence = maxConf;
+      trackedPatch = patches->getRect(maxI);
+      return true;
+    }
+
+    bool
+    BeyondSemiBoostingTracker::track(ImageRepresentation* image, ImageRepresentation* BGMRep, Patches* patches)
+    {
+      // tracker lost or still tracking?
+      if (confidence <= 0)
+      {
+        //INITIALIZATION FLOW: re-detect with the off-line detector
+        float sumAlpha = classifierOff->getSumAlpha();
+        float maxConf = -100.0f;
+        int maxIdx = -1;
+        for (int i = 0; i < patches->getNum(); i++)
+        {
+          float tempConf = classifierOff->eval(image, patches->getRect(i));
+          if (tempConf > maxConf)
+          {
+            maxConf = tempConf;
+            maxIdx = i;
+          }
+        }
+        maxConf = maxConf / sumAlpha;
+        if (maxIdx < 0 || maxConf <= offThreshold)
+          return false;
+
+        Rect initRect = patches->getRect(maxIdx);
+        int iterationInit = 25;
+        for (int curInitStep = 0; curInitStep < iterationInit; curInitStep++)
+        {
+          std::cout << "\rreinit tracker... " << int(((float) curInitStep) / (iterationInit - 1) * 100) << " %%";
+          initClassifier(initRect, image, patches, false, true, true);
+        }
+        std::cout << std::endl;
+        confidence = 0.5f;
+        trackedPatch = initRect;
+        return true;
+      }
+
+      //TRACKING FLOW
+      //look for maximum of classifier with confidence map analysis and update classifier with classifierOn as prior
+      update(image, BGMRep, patches);
+
+      if (confidence <= 0)
+      {
+        //tracker lost -> start over the tracking classifier and the recognizer
+        int numWeakClassifier = 100;
+        bool useFeatureExchange = true;
+        int iterationInit = 50;
+        Size patchSize(trackedPatch.width, trackedPatch.height);
+        classifierOn = new StrongClassifierStandardSemi(numBaseClassifier, numWeakClassifier, patchSize,
+                                                        useFeatureExchange, iterationInit);
+        classifier = new StrongClassifierStandardSemi(numBaseClassifier, numWeakClassifier, patchSize,
+                                                      useFeatureExchange, iterationInit);
+        return false;
+      }
+
+      //if maximum is stable -> update the prior with the detection close to the track
+      float sumAlpha = 1.0f / classifierOff->getSumAlpha();
+      float maxConf = -1.0f;
+      for (int i = 0; i < patches->getNum(); i++)
+      {
+        Rect tmpRect = patches->getRect(i);
+        if (tmpRect.x > trackedPatch.x - trackedPatch.width / 5 && tmpRect.y > trackedPatch.y - trackedPatch.height / 5
+            && tmpRect.x < trackedPatch.x + trackedPatch.width / 5
+            && tmpRect.y < trackedPatch.y + trackedPatch.height / 5)
+        {
+          float tempConf = classifierOff->eval(image, tmpRect) * sumAlpha;
+          if (tempConf > maxConf)
+            maxConf = tempConf;
+        }
+      }
+      if (maxConf > offThreshold)
+        updateOn(image, BGMRep, patches);
+
+      return true;
+    }
+
+    Rect
+    BeyondSemiBoostingTracker::getTrackingROI(float searchFactor)
+    {
+      Rect searchRegion;
+
+      searchRegion = RectMultiply(trackedPatch, searchFactor);
+      //check
+      if (searchRegion.y + searchRegion.height > validROI.height)
+        searchRegion.height = validROI.height - searchRegion.y;
+      if (searchRegion.x + searchRegion.width > validROI.width)
+        searchRegion.width = validROI.width - searchRegion.x;
+
+      return searchRegion;
+    }
+
+    float
+    BeyondSemiBoostingTracker::getConfidence()
+    {
+      return confidence;
+    }
+
+    Rect
+    BeyondSemiBoostingTracker::getTrackedPatch()
+    {
+      return trackedPatch;
+    }
+
+    cv::Point2i
+    BeyondSemiBoostingTracker::getCenter()
+    {
+      cv::Point2i center;
+      center.y = trackedPatch.y + trackedPatch.height / 2;
+      center.x = trackedPatch.x + trackedPatch.width / 2;
+      return center;
+    }
+
   }
 }
 
@@ -46,6 +46,11 @@
 #include <omp.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIL_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "cv_onlinemil.h"
 
 /****************************************************************************************
@@ -61,22 +66,28 @@
 using namespace std;
 
 void
-compute_integral(const cv::Mat & img, std::vector<cv::Mat_<float> > & ii_imgs)
+compute_integral(const cv::Mat & img, cv::mil::IntegralImage & ii, bool gradient)
 {
-  cv::Mat ii_img;
-  cv::integral(img, ii_img, CV_32F);
-  cv::split(ii_img, ii_imgs);
+  if (img.depth() == CV_8U)
+  {
+    ii.channels = img.channels() + (gradient ? 1 : 0);
+    ii.sum.create(img.rows + 1, (img.cols + 1) * ii.channels);
+    haar::integral_channels(img.ptr<unsigned char>(), img.cols, img.rows, (int) img.step, img.channels(), gradient,
+                            (float*) ii.sum.data, (int) ii.sum.step1());
+    return;
+  }
+  CV_Assert(!gradient);
+  // already interleaved
+  cv::Mat sum;
+  cv::integral(img, sum, CV_32F);
+  ii.channels = img.channels();
+  ii.sum = sum.reshape(1);
 }
 
 namespace cv
 {
   namespace mil
   {
-    //////////////////////////////////////////////////////////////////////////////////////////////////////
-    /** Static random number generator shared between functions
-     */
-    cv::RNG RandomGenerator::rng_ = cv::RNG();
-
     std::string
     int2str(int i, int ndigits)
     {
@@ -95,11 +106,8 @@ namespace cv
       cv::imshow(name, img);
     }
 
-    Sample::Sample(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_imgs, int row, int col, int width,
-                   int height, float weight)
+    Sample::Sample(int row, int col, int width, int height, float weight)
     {
-      _img = img;
-      _ii_imgs = ii_imgs;
       _row = row;
       _col = col;
       _width = width;
@@ -108,7 +116,7 @@ namespace cv
     }
 
     void
-    SampleSet::sampleImage(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_imgs, int x, int y, int w,
+    SampleSet::sampleImage(const cv::Mat & img, const IntegralImage & ii, RandomStream & rng, int x, int y, int w,
                            int h, float inrad, float outrad, int maxnum)
     {
       int rowsz = img.rows - h - 1;
@@ -117,54 +125,67 @@ namespace cv
       float outradsq = outrad * outrad;
       int dist;
 
-      uint minrow = max(0, (int) y - (int) inrad);
-      uint maxrow = min((int) rowsz - 1, (int) y + (int) inrad);
-      uint mincol = max(0, (int) x - (int) inrad);
-      uint maxcol = min((int) colsz - 1, (int) x + (int) inrad);
+      int minrow = max(0, (int) y - (int) inrad);
+      int maxrow = min((int) rowsz - 1, (int) y + (int) inrad);
+      int mincol = max(0, (int) x - (int) inrad);
+      int maxcol = min((int) colsz - 1, (int) x + (int) inrad);
 
       //fprintf(stderr,"inrad=%f minrow=%d maxrow=%d mincol=%d maxcol=%d\n",inrad,minrow,maxrow,mincol,maxcol);
 
-      _samples.resize((maxrow - minrow + 1) * (maxcol - mincol + 1));
-      int i = 0;
-
-      float prob = ((float) (maxnum)) / _samples.size();
+      setImage(img, ii);
+      _ftrVals.release();
+      _samples.clear();
 
-      for (int r = minrow; r <= (int) maxrow; r++)
-        for (int c = mincol; c <= (int) maxcol; c++)
+      // all the points of the donut, row by row
+      for (int r = minrow; r <= maxrow; r++)
+        for (int c = mincol; c <= maxcol; c++)
         {
           dist = (y - r) * (y - r) + (x - c) * (x - c);
-          if (RandomGenerator::randfloat() < prob && dist < inradsq && dist >= outradsq)
-          {
-            _samples[i]._img = img;
-            _samples[i]._ii_imgs = ii_imgs;
-            _samples[i]._col = c;
-            _samples[i]._row = r;
-            _samples[i]._height = h;
-            _samples[i]._width = w;
-            i++;
-          }
+          if (dist < inradsq && dist >= outradsq)
+            _samples.push_back(Sample(r, c, w, h));
         }
 
-      _samples.resize(min(i, maxnum));
+      int numpts = _samples.size();
+      if (maxnum < 0 || numpts <= maxnum)
+        return;
+
+      // maxnum distinct points (Floyd's algorithm: one draw per point), kept in the row by row order
+      std::vector<char> chosen(numpts, 0);
+      for (int j = numpts - maxnum; j < numpts; j++)
+      {
+        int t = rng.randint(0, j + 1);
+        chosen[chosen[t] ? j : t] = 1;
+      }
+      int i = 0;
+      for (int k = 0; k < numpts; k++)
+        if (chosen[k])
+          _samples[i++] = _samples[k];
+      _samples.resize(maxnum);
 
     }
 
     void
-    SampleSet::sampleImage(const cv::Mat & img, const std::vector<cv::Mat_<float> > & ii_imgs, uint num, int w, int h)
+    SampleSet::sampleImage(const cv::Mat & img, const IntegralImage & ii, RandomStream & rng, uint num, int w, int h)
     {
       int rowsz = img.rows - h - 1;
       int colsz = img.cols - w - 1;
 
+      setImage(img, ii);
+      _ftrVals.release();
       _samples.resize(num);
+      // sample i draws the numbers 2 i and 2 i + 1 from the current position, whatever the thread
+      uint64 pos = rng.pos();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
       for (int i = 0; i < (int) num; i++)
       {
-        _samples[i]._img = img;
-        _samples[i]._ii_imgs = ii_imgs;
-        _samples[i]._col = RandomGenerator::randint(0, colsz);
-        _samples[i]._row = RandomGenerator::randint(0, rowsz);
+        _samples[i]._col = RandomStream::toInt(rng.at(pos + 2 * i), 0, colsz);
+        _samples[i]._row = RandomStream::toInt(rng.at(pos + 2 * i + 1), 0, rowsz);
         _samples[i]._height = h;
         _samples[i]._width = w;
       }
+      rng.skip(2 * (uint64) num);
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -189,12 +210,12 @@ namespace cv
     }
 
     void
-    HaarFtr::generate(FtrParams *op)
+    HaarFtr::generate(FtrParams *op, RandomStream &rng)
     {
       HaarFtrParams *p = (HaarFtrParams*) op;
       _width = p->_width;
       _height = p->_height;
-      int numrects = RandomGenerator::randint(p->_minNumRect, p->_maxNumRect);
+      int numrects = rng.randint(p->_minNumRect, p->_maxNumRect);
       _rects.resize(numrects);
       _weights.resize(numrects);
       _rsums.resize(numrects);
@@ -202,14 +223,14 @@ namespace cv
 
       for (int k = 0; k < numrects; k++)
       {
-        _weights[k] = RandomGenerator::randfloat(-1, 1);
-        _rects[k].x = RandomGenerator::randint(0, (uint) (p->_width - 3));
-        _rects[k].y = RandomGenerator::randint(0, (uint) (p->_height - 3));
-        _rects[k].width = RandomGenerator::randint(1, (p->_width - _rects[k].x - 2));
-        _rects[k].height = RandomGenerator::randint(1, (p->_height - _rects[k].y - 2));
+        _weights[k] = rng.randfloat(-1, 1);
+        _rects[k].x = rng.randint(0, (uint) (p->_width - 3));
+        _rects[k].y = rng.randint(0, (uint) (p->_height - 3));
+        _rects[k].width = rng.randint(1, (p->_width - _rects[k].x - 2));
+        _rects[k].height = rng.randint(1, (p->_height - _rects[k].y - 2));
         _rsums[k] = std::abs(_weights[k] * (_rects[k].width + 1) * (_rects[k].height + 1) * 255);
-        //_rects[k].width = RandomGenerator::randint(1,3);
-        //_rects[k].height = RandomGenerator::randint(1,3);
+        //_rects[k].width = rng.randint(1,3);
+        //_rects[k].height = rng.randint(1,3);
       }
 
       if (p->_numCh < 0)
@@ -219,7 +240,7 @@ namespace cv
           p->_numCh += p->_useChannels[k] >= 0;
       }
 
-      _channel = p->_useChannels[RandomGenerator::randint(0, p->_numCh - 1)];
+      _channel = p->_useChannels[rng.randint(0, p->_numCh)];
     }
 
     cv::Mat
@@ -246,28 +267,115 @@ namespace cv
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Features are computed over blocks of samples: the features of nearby windows read the same integral
+    // image rows. A multiple of SampleSet::FTR_ALIGN, so that the blocks of a row start on cache lines.
+    static const int SAMPLE_BLOCK = 128;
+
+    /** Haar features ftrs[which[k]] of the samples, evaluated with a compiled feature table.
+     * Returns false (nothing computed) for other features.
+     */
+    static bool
+    computeHaar(SampleSet &samples, const vecFtr &ftrs, const vectori &which)
+    {
+      int numftrs = which.size();
+      int numsamples = samples.size();
+      const IntegralImage & ii = samples.integral();
+      if (ii.empty())
+        return false;
+
+      // a single interleaved buffer: the channel is part of the corner offsets
+      haar::FeatureTable table;
+      for (int k = 0; k < numftrs; k++)
+      {
+        Ftr* ftr = ftrs[which[k]];
+        if (ftr->ftrType() != 0)
+          return false;
+        const HaarFtr* haar_ftr = static_cast<const HaarFtr*>(ftr);
+        if ((int) haar_ftr->_channel >= ii.channels)
+          return false;
+        table.add_feature(haar_ftr->_channel);
+        for (int r = 0; r < (int) haar_ftr->_rects.size(); r++)
+        {
+          float weight;
+          cv::Rect rect = haar_ftr->scaledRect(r, samples.scale(), weight);
+          table.add_rect(rect.x, rect.y, rect.width, rect.height, weight);
+        }
+      }
+      table.compile((int) ii.sum.step1(), ii.channels);
+      const float* sum = (const float*) ii.sum.data;
+
+      std::vector<int> offsets(numsamples);
+      for (int k = 0; k < numsamples; k++)
+        offsets[k] = table.offset(samples[k]._col, samples[k]._row);
+
+      int numblocks = (numsamples + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (int b = 0; b < numblocks; b++)
+      {
+        int first = b * SAMPLE_BLOCK;
+        int count = std::min(SAMPLE_BLOCK, numsamples - first);
+        for (int k = 0; k < numftrs; k++)
+          table.evaluate(k, sum, &offsets[first], count, &samples.getFtrVal(first, which[k]));
+      }
+      return true;
+    }
+
     void
     Ftr::compute(SampleSet &samples, const vecFtr &ftrs)
     {
-      int numftrs = ftrs.size();
+      vectori which(ftrs.size());
+      for (int ftr = 0; ftr < (int) which.size(); ftr++)
+        which[ftr] = ftr;
+      compute(samples, ftrs, which);
+    }
+
+    void
+    Ftr::compute(SampleSet &samples, const vecFtr &ftrs, const vectori &which)
+    {
       int numsamples = samples.size();
-      if (numsamples == 0)
+      if (numsamples == 0 || ftrs.empty())
         return;
 
-      samples.resizeFtrs(numftrs);
+      if (samples.numFtrs() != (int) ftrs.size())
+        samples.resizeFtrs(ftrs.size());
 
+      // skip the features already computed (and duplicates)
+      vectori todo;
+      todo.reserve(which.size());
+      for (size_t k = 0; k < which.size(); k++)
+        if (!samples.ftrComputed(which[k]))
+        {
+          todo.push_back(which[k]);
+          samples.setFtrComputed(which[k]);
+        }
+      if (todo.empty())
+        return;
+
+      if (computeHaar(samples, ftrs, todo))
+        return;
+
+      int numtodo = todo.size();
+      int numblocks = (numsamples + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-      for (int ftr = 0; ftr < numftrs; ftr++)
+      for (int b = 0; b < numblocks; b++)
       {
-        for (int k = 0; k < numsamples; k++)
+        int end = std::min((b + 1) * SAMPLE_BLOCK, numsamples);
+        for (int t = 0; t < numtodo; t++)
         {
-          samples.getFtrVal(k, ftr) = ftrs[ftr]->compute(samples[k]);
+          int ftr = todo[t];
+          for (int k = b * SAMPLE_BLOCK; k < end; k++)
+          {
+            samples.getFtrVal(k, ftr) = ftrs[ftr]->compute(samples, k);
+          }
         }
       }
 
     }
+
     void
     Ftr::compute(SampleSet &samples, Ftr *ftr, int ftrind)
     {
@@ -279,12 +387,14 @@ namespace cv
 #endif
       for (int k = 0; k < numsamples; k++)
       {
-        samples.getFtrVal(k, ftrind) = ftr->compute(samples[k]);
+        samples.getFtrVal(k, ftrind) = ftr->compute(samples, k);
       }
+      if (ftrind < samples.numFtrs())
+        samples.setFtrComputed(ftrind);
 
     }
     vecFtr
-    Ftr::generate(FtrParams *params, uint num)
+    Ftr::generate(FtrParams *params, uint num, RandomStream &rng)
     {
       vecFtr ftrs;
 
@@ -297,7 +407,7 @@ namespace cv
             ftrs[k] = new HaarFtr();
             break;
         }
-        ftrs[k]->generate(params);
+        ftrs[k]->generate(params, rng);
       }
 
       // DEBUG
@@ -353,21 +463,50 @@ namespace cv
     cv::Mat_<float>
     ClfStrong::applyToImage(ClfStrong *clf, const cv::Mat & img, bool logR)
     {
-      std::vector<cv::Mat_<float> > ii_imgs;
-      compute_integral(img, ii_imgs);
-      cv::Mat_<float> resp(img.rows, img.cols);
+      return applyToImage(clf, img, cv::Rect(0, 0, img.cols, img.rows), logR);
+    }
+
+    cv::Mat_<float>
+    ClfStrong::applyToImage(ClfStrong *clf, const cv::Mat & img, const cv::Rect & roi, bool logR)
+    {
       int height = clf->_params->_ftrParams->_height;
       int width = clf->_params->_ftrParams->_width;
-
-      //int rowsz = img.rows() - width - 1;
-      //int colsz = img.cols() - height - 1;
-
+      bool gradient = clf->_params->_ftrParams->_gradient;
+      cv::Mat_<float> resp(roi.height, roi.width);
+      resp.setTo(-std::numeric_limits<float>::max());
+
+      // top left corners whose box fits in the image (the bounds of SampleSet::sampleImage)
+      cv::Rect valid = roi & cv::Rect(0, 0, img.cols - width - 1, img.rows - height - 1);
+      if (valid.width <= 0 || valid.height <= 0)
+        return resp;
+
+      // integral images of the part of the image the boxes cover only, with one more pixel for the gradient
+      cv::Rect cover(valid.x, valid.y, valid.width + width + 1, valid.height + height + 1);
+      if (gradient)
+        cover = cv::Rect(cover.x - 1, cover.y - 1, cover.width + 2, cover.height + 2) & cv::Rect(0, 0, img.cols,
+                                                                                                   img.rows);
+      cv::Mat crop = img(cover);
+      IntegralImage ii;
+      compute_integral(crop, ii, gradient);
+
+      // every location of the roi
       SampleSet x;
-      x.sampleImage(img, ii_imgs, 0, 0, width, height, 100000); // sample every point
-      Ftr::compute(x, clf->_ftrs);
+      x.setImage(crop, ii);
+      x.resize(valid.area());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (int r = 0; r < valid.height; r++)
+        for (int c = 0; c < valid.width; c++)
+          x[r * valid.width + c] = Sample(valid.y + r - cover.y, valid.x + c - cover.x, width, height);
+
       vectorf rf = clf->classify(x, logR);
-      for (int i = 0; i < x.size(); i++)
-        resp(x[i]._row, x[i]._col) = rf[i];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (int r = 0; r < valid.height; r++)
+        for (int c = 0; c < valid.width; c++)
+          resp(valid.y - roi.y + r, valid.x - roi.x + c) = rf[r * valid.width + c];
 
       return resp;
     }
@@ -428,7 +567,8 @@ namespace cv
       resizeVec(_countTNv, _myParams->_numSel, _myParams->_numFeat, 1.0f);
 
       _alphas.resize(_myParams->_numSel, 0);
-      _ftrs = Ftr::generate(_myParams->_ftrParams, _myParams->_numFeat);
+      RandomStream rng(_myParams->_seed);
+      _ftrs = Ftr::generate(_myParams->_ftrParams, _myParams->_numFeat, rng);
       _selectors.resize(_myParams->_numSel, 0);
       _weakclf.resize(_myParams->_numFeat);
       for (int k = 0; k < _myParams->_numFeat; k++)
@@ -580,7 +720,8 @@ namespace cv
       _myParams = (ClfMilBoostParams*) params;
       _numsamples = 0;
 
-      _ftrs = Ftr::generate(_myParams->_ftrParams, _myParams->_numFeat);
+      RandomStream rng(_myParams->_seed);
+      _ftrs = Ftr::generate(_myParams->_ftrParams, _myParams->_numFeat, rng);
       if (params->_storeFtrHistory)
         Ftr::toViz(_ftrs, "haarftrs");
       _weakclf.resize(_myParams->_numFeat);
@@ -607,12 +748,234 @@ namespace cv
 
       _counter = 0;
     }
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // res[j] += log p1(v[j]) - log p0(v[j]) of one stump for the samples [first, end), or +-alpha by its sign,
+    // in the same float operations as ClfOnlineStump::classifyF
+    static void
+    stumpLogOdds(const float *v, int first, int end, float mu0, float mu1, float e0, float e1, float log_n0,
+                 float log_n1, const float *alpha, float *res)
+    {
+      int j = first;
+#ifdef MIL_SSE2
+      const __m128 m0 = _mm_set1_ps(mu0), m1 = _mm_set1_ps(mu1), f0 = _mm_set1_ps(e0), f1 = _mm_set1_ps(e1);
+      const __m128 n0 = _mm_set1_ps(log_n0), n1 = _mm_set1_ps(log_n1);
+      const __m128 a = _mm_set1_ps(alpha ? *alpha : 0.0f), na = _mm_set1_ps(alpha ? -*alpha : 0.0f);
+      for (; j + 4 <= end; j += 4)
+      {
+        __m128 x = _mm_loadu_ps(v + j);
+        __m128 d0 = _mm_sub_ps(x, m0), d1 = _mm_sub_ps(x, m1);
+        __m128 p0 = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(d0, d0), f0), n0);
+        __m128 p1 = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(d1, d1), f1), n1);
+        __m128 r;
+        if (alpha)
+        {
+          __m128 gt = _mm_cmpgt_ps(p1, p0);
+          r = _mm_or_ps(_mm_and_ps(gt, a), _mm_andnot_ps(gt, na));
+        }
+        else
+          r = _mm_sub_ps(p1, p0);
+        _mm_storeu_ps(res + j, _mm_add_ps(_mm_loadu_ps(res + j), r));
+      }
+#endif
+      for (; j < end; j++)
+      {
+        float p0 = (v[j] - mu0) * (v[j] - mu0) * e0 + log_n0;
+        float p1 = (v[j] - mu1) * (v[j] - mu1) * e1 + log_n1;
+        if (alpha)
+          res[j] += p1 > p0 ? *alpha : -*alpha;
+        else
+          res[j] += p1 - p0;
+      }
+    }
+
+    bool
+    ClfOnlineStump::classifyBatch(const std::vector<ClfWeak*> &weakclf, const vectori &selectors, const SampleSet &x,
+                                  const float *alphas, vectorf &res)
+    {
+      int numsel = selectors.size();
+      int numsamples = x.size();
+
+      // parameters of the selected stumps, structure of arrays
+      vectorf mu0(numsel), mu1(numsel), e0(numsel), e1(numsel), log_n0(numsel), log_n1(numsel);
+      std::vector<const float*> vals(numsel);
+      for (int s = 0; s < numsel; s++)
+      {
+        const ClfOnlineStump *stump = dynamic_cast<const ClfOnlineStump*>(weakclf[selectors[s]]);
+        if (!stump || !x.ftrComputed(stump->_ind))
+          return false;
+        mu0[s] = stump->_mu0;
+        mu1[s] = stump->_mu1;
+        e0[s] = stump->_e0;
+        e1[s] = stump->_e1;
+        log_n0[s] = stump->_log_n0;
+        log_n1[s] = stump->_log_n1;
+        vals[s] = x.ftrVals(stump->_ind).data;
+      }
+
+      res.assign(numsamples, 0.0f);
+      int numblocks = (numsamples + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (int b = 0; b < numblocks; b++)
+      {
+        int first = b * SAMPLE_BLOCK;
+        int end = std::min(first + SAMPLE_BLOCK, numsamples);
+        for (int s = 0; s < numsel; s++)
+          stumpLogOdds(vals[s], first, end, mu0[s], mu1[s], e0[s], e1[s], log_n0[s], log_n1[s],
+                       alphas ? alphas + s : NULL, &res[0]);
+      }
+      return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Bag likelihoods of the MIL selection, four samples at a time with the Cephes single precision exp
+    // and log polynomials (relative error ~1e-7 on the ranges used here)
+
+#ifdef MIL_SSE2
+    static inline __m128
+    exp_ps(__m128 x)
+    {
+      const __m128 one = _mm_set1_ps(1.0f);
+      x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+      x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+
+      // n = floor(x / ln 2 + 0.5)
+      __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+      __m128 tmp = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+      fx = _mm_sub_ps(tmp, _mm_and_ps(_mm_cmpgt_ps(tmp, fx), one));
+
+      x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+      x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+      __m128 z = _mm_mul_ps(x, x);
+      __m128 y = _mm_set1_ps(1.9875691500E-4f);
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+      y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), one);
+
+      // 2^n
+      __m128i n = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(0x7f)), 23);
+      return _mm_mul_ps(y, _mm_castsi128_ps(n));
+    }
+
+    // x > 0
+    static inline __m128
+    log_ps(__m128 x)
+    {
+      const __m128 one = _mm_set1_ps(1.0f);
+      x = _mm_max_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x00800000))); // smallest normal
+
+      // x = m 2^e with m in [0.5, 1)
+      __m128i emm0 = _mm_srli_epi32(_mm_castps_si128(x), 23);
+      x = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(~0x7f800000)));
+      x = _mm_or_ps(x, _mm_set1_ps(0.5f));
+      __m128 e = _mm_add_ps(_mm_cvtepi32_ps(_mm_sub_epi32(emm0, _mm_set1_epi32(0x7f))), one);
+
+      // m < sqrt(1/2): e -= 1, x = 2m - 1; otherwise x = m - 1
+      __m128 mask = _mm_cmplt_ps(x, _mm_set1_ps(0.707106781186547524f));
+      __m128 tmp = _mm_and_ps(x, mask);
+      x = _mm_sub_ps(x, one);
+      e = _mm_sub_ps(e, _mm_and_ps(one, mask));
+      x = _mm_add_ps(x, tmp);
+
+      __m128 z = _mm_mul_ps(x, x);
+      __m128 y = _mm_set1_ps(7.0376836292E-2f);
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.1514610310E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.1676998740E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.2420140846E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.4249322787E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.6668057665E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(2.0000714765E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-2.4999993993E-1f));
+      y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(3.3333331174E-1f));
+      y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+
+      y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+      y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+      x = _mm_add_ps(x, y);
+      return _mm_add_ps(x, _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+    }
+
+    // sum of the four lanes
+    static inline float
+    hsum_ps(__m128 v)
+    {
+      v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+      v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+      return _mm_cvtss_f32(v);
+    }
+
+    // product of the four lanes
+    static inline float
+    hprod_ps(__m128 v)
+    {
+      v = _mm_mul_ps(v, _mm_movehl_ps(v, v));
+      v = _mm_mul_ss(v, _mm_shuffle_ps(v, v, 1));
+      return _mm_cvtss_f32(v);
+    }
+#endif
+
+    /** -log(1 - prod_j (1 - sigmoid(H[j] + pred[j])) + 1e-5): likelihood of the positive bag with a weak
+     * classifier's predictions pred added to the strong classifier's H
+     */
+    static float
+    posBagLikl(const float *H, const float *pred, int n)
+    {
+      float lll = 1.0f;
+      int j = 0;
+#ifdef MIL_SSE2
+      const __m128 one = _mm_set1_ps(1.0f);
+      __m128 prod = one;
+      for (; j + 4 <= n; j += 4)
+      {
+        // 1 - sigmoid(z) = 1 / (1 + exp(z))
+        __m128 z = _mm_add_ps(_mm_loadu_ps(H + j), _mm_loadu_ps(pred + j));
+        prod = _mm_div_ps(prod, _mm_add_ps(one, exp_ps(z)));
+      }
+      lll = hprod_ps(prod);
+#endif
+      for (; j < n; j++)
+        lll *= (1 - sigmoid(H[j] + pred[j]));
+      return (float) -log(1 - lll + 1e-5);
+    }
+
+    /** sum_j -log(1e-5 + 1 - sigmoid(H[j] + pred[j])): likelihood of the negatives
+     */
+    static float
+    negLikl(const float *H, const float *pred, int n)
+    {
+      float lll = 0.0f;
+      int j = 0;
+#ifdef MIL_SSE2
+      const __m128 one = _mm_set1_ps(1.0f);
+      __m128 sum = _mm_setzero_ps();
+      for (; j + 4 <= n; j += 4)
+      {
+        __m128 z = _mm_add_ps(_mm_loadu_ps(H + j), _mm_loadu_ps(pred + j));
+        __m128 p = _mm_add_ps(_mm_set1_ps(1e-5f), _mm_div_ps(one, _mm_add_ps(one, exp_ps(z))));
+        sum = _mm_sub_ps(sum, log_ps(p));
+      }
+      lll = hsum_ps(sum);
+#endif
+      for (; j < n; j++)
+        lll += (float) -log(1e-5f + 1 - sigmoid(H[j] + pred[j]));
+      return lll;
+    }
+
     void
     ClfMilBoost::update(SampleSet &posx, SampleSet &negx)
     {
       int numneg = negx.size();
       int numpos = posx.size();
 
+      // the bag likelihoods need both bags (e.g. no negatives fit in a small frame):
+      // keep the current selection
+      if (numpos == 0 || numneg == 0)
+        return;
+
       // compute ftrs
       if (!posx.ftrsComputed())
         Ftr::compute(posx, _ftrs);
@@ -620,14 +983,14 @@ namespace cv
         Ftr::compute(negx, _ftrs);
 
       // initialize H
-      static vectorf Hpos, Hneg;
-      Hpos.clear();
-      Hneg.clear();
-      Hpos.resize(posx.size(), 0.0f), Hneg.resize(negx.size(), 0.0f);
+      vectorf &Hpos = _Hpos, &Hneg = _Hneg;
+      Hpos.assign(posx.size(), 0.0f);
+      Hneg.assign(negx.size(), 0.0f);
 
       _selectors.clear();
-      vectorf posw(posx.size()), negw(negx.size());
-      vector<vectorf> pospred(_weakclf.size()), negpred(_weakclf.size());
+      vector<vectorf> &pospred = _pospred, &negpred = _negpred;
+      pospred.resize(_weakclf.size());
+      negpred.resize(_weakclf.size());
 
       // train all weak classifiers without weights
 #ifdef _OPENMP
@@ -640,41 +1003,46 @@ namespace cv
         negpred[m] = _weakclf[m]->classifySetF(negx);
       }
 
-      // pick the best features
+      // pick the best features: the unselected weak clf of least negative log likelihood
+      std::vector<char> selected(_weakclf.size(), 0);
       for (int s = 0; s < _myParams->_numSel; s++)
       {
-
-        // compute errors/likl for all weak clfs
-        vectorf poslikl(_weakclf.size(), 1.0f), neglikl(_weakclf.size()), likl(_weakclf.size());
+        int best = -1;
+        float bestlikl = 0.0f;
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel
 #endif
-        for (int w = 0; w < (int) _weakclf.size(); w++)
         {
-          float lll = 1.0f;
-          for (int j = 0; j < numpos; j++)
-            lll *= (1 - sigmoid(Hpos[j] + pospred[w][j]));
-          poslikl[w] = (float) -log(1 - lll + 1e-5);
-
-          lll = 0.0f;
-          for (int j = 0; j < numneg; j++)
-            lll += (float) -log(1e-5f + 1 - sigmoid(Hneg[j] + negpred[w][j]));
-          neglikl[w] = lll;
-
-          likl[w] = poslikl[w] / numpos + neglikl[w] / numneg;
-        }
-
-        // pick best weak clf
-        vectori order;
-        sort_order_des(likl, order);
-
-        // find best weakclf that isn't already included
-        for (uint k = 0; k < order.size(); k++)
-          if (count(_selectors.begin(), _selectors.end(), order[k]) == 0)
+          int mybest = -1;
+          float mylikl = 0.0f;
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+          for (int w = 0; w < (int) _weakclf.size(); w++)
           {
-            _selectors.push_back(order[k]);
-            break;
+            if (selected[w])
+              continue;
+            float likl = posBagLikl(&Hpos[0], &pospred[w][0], numpos) / numpos
+                + negLikl(&Hneg[0], &negpred[w][0], numneg) / numneg;
+            if (mybest < 0 || likl < mylikl)
+            {
+              mybest = w;
+              mylikl = likl;
+            }
+          }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+          if (mybest >= 0 && (best < 0 || mylikl < bestlikl || (mylikl == bestlikl && mybest < best)))
+          {
+            best = mybest;
+            bestlikl = mylikl;
           }
+        }
+        if (best < 0)
+          break;
+        selected[best] = 1;
+        _selectors.push_back(best);
 
         // update H = H + h_m
 #ifdef _OPENMP
@@ -702,88 +1070,116 @@ namespace cv
     bool
     SimpleTracker::init(const cv::Mat & frame, const SimpleTrackerParams p, ClfStrongParams *clfparams)
     {
-      static cv::Mat img;
-
-      img = frame;
-      std::vector<cv::Mat_<float> > ii_imgs;
-      compute_integral(img, ii_imgs);
+      const cv::Mat & img = frame;
+      IntegralImage & ii = _ii;
+      FtrParams *ftrparams = clfparams->_ftrParams;
+      if (ftrparams->_gradient && ftrparams->ftrType() == 0)
+      {
+        // the gradient channel follows the image channels; it is computed for nothing unless features can use it
+        HaarFtrParams *haarparams = (HaarFtrParams*) ftrparams;
+        bool used = false;
+        for (int k = 0; k < 1024; k++)
+          used = used || haarparams->_useChannels[k] == img.channels();
+        if (!used)
+          abortError(__LINE__, __FILE__, "_gradient is set but _useChannels does not select the gradient channel");
+      }
+      compute_integral(img, ii, ftrparams->_gradient);
 
       _clf = ClfStrong::makeClf(clfparams);
       _curState.resize(4);
       for (int i = 0; i < 4; i++)
         _curState[i] = p._initstate[i];
-      SampleSet posx, negx;
+      SampleSet &posx = _posx, &negx = _negx;
 
       fprintf(stderr, "Initializing Tracker..\n");
 
       // sample positives and negatives from first frame
-      posx.sampleImage(img, ii_imgs, (uint) _curState[0], (uint) _curState[1], (uint) _curState[2], (uint) _curState[3],
-                       p._init_postrainrad);
-      negx.sampleImage(img, ii_imgs, (uint) _curState[0], (uint) _curState[1], (uint) _curState[2], (uint) _curState[3],
-                       2.0f * p._srchwinsz, (1.5f * p._init_postrainrad), p._init_negnumtrain);
+      _rng.init(p._seed, 1);
+      posx.sampleImage(img, ii, _rng, (uint) _curState[0], (uint) _curState[1], (uint) _curState[2],
+                       (uint) _curState[3], p._init_postrainrad);
+      negx.sampleImage(img, ii, _rng, (uint) _curState[0], (uint) _curState[1], (uint) _curState[2],
+                       (uint) _curState[3], 2.0f * p._srchwinsz, (1.5f * p._init_postrainrad), p._init_negnumtrain);
       if (posx.size() < 1 || negx.size() < 1)
+      {
+        posx.clear();
+        negx.clear();
         return false;
+      }
 
       // train
       _clf->update(posx, negx);
+      posx.clear();
       negx.clear();
 
       _trparams = p;
       _clfparams = clfparams;
       _cnt = 0;
+      _scale = 1.0f;
       return true;
     }
 
     double
     SimpleTracker::track_frame(const cv::Mat & frame)
     {
-      static SampleSet posx, negx, detectx;
-      static vectorf prob;
-      static vectori order;
-      static cv::Mat img;
+      SampleSet &posx = _posx, &negx = _negx, &detectx = _detectx;
+      vectorf &prob = _prob;
+      const cv::Mat & img = frame;
 
       double resp;
 
-      img = frame;
-      std::vector<cv::Mat_<float> > ii_imgs;
-      compute_integral(img, ii_imgs);
+      // the sample sets of the previous frame were cleared, so the integral images are updated in place
+      IntegralImage & ii = _ii;
+      compute_integral(img, ii, _clfparams->_ftrParams->_gradient);
 
       // run current clf on search window
-      detectx.sampleImage(img, ii_imgs, (uint) _curState[0], (uint) _curState[1], (uint) _curState[2],
+      detectx.sampleImage(img, ii, _rng, (uint) _curState[0], (uint) _curState[1], (uint) _curState[2],
                           (uint) _curState[3], (float) _trparams._srchwinsz);
-      prob = _clf->classify(detectx, _trparams._useLogR);
+      detectx.setScale(_scale);
+      if (_trparams._scales.empty())
+        prob = _clf->classify(detectx, _trparams._useLogR);
+      else
+        searchScales(img, ii);
+
+      if (_trparams._storeResponse || _trparams._debugv)
+        storeResponse((int) _curState[0], (int) _curState[1]);
 
       /////// DEBUG /////// display actual probability map
       if (_trparams._debugv)
       {
-        cv::Mat_<float> probimg(frame.rows, frame.cols);
-        for (uint k = 0; k < (uint) detectx.size(); k++)
-          probimg(detectx[k]._row, detectx[k]._col) = prob[k];
-
-        display(probimg, 2, 2);
+        display(_respMap, 2, 2);
         cv::waitKey(1);
       }
 
-      // find best location
+      // find best location (and size)
       int bestind = max_idx(prob);
       resp = prob[bestind];
 
       _curState[1] = (float) detectx[bestind]._row;
       _curState[0] = (float) detectx[bestind]._col;
+      _curState[2] = (float) detectx[bestind]._width;
+      _curState[3] = (float) detectx[bestind]._height;
+      if (!_trparams._scales.empty())
+        _scale = _curState[2] / _clfparams->_ftrParams->_width;
 
       // train location clf (negx are randomly selected from image, posx is just the current tracker location)
 
       if (_trparams._negsamplestrat == 0)
-        negx.sampleImage(img, ii_imgs, _trparams._negnumtrain, (int) _curState[2], (int) _curState[3]);
+        negx.sampleImage(img, ii, _rng, _trparams._negnumtrain, (int) _curState[2], (int) _curState[3]);
       else
-        negx.sampleImage(img, ii_imgs, (int) _curState[0], (int) _curState[1], (int) _curState[2], (int) _curState[3],
-                         (1.5f * _trparams._srchwinsz), _trparams._posradtrain + 5, _trparams._negnumtrain);
+        negx.sampleImage(img, ii, _rng, (int) _curState[0], (int) _curState[1], (int) _curState[2],
+                         (int) _curState[3], (1.5f * _trparams._srchwinsz), _trparams._posradtrain + 5,
+                         _trparams._negnumtrain);
 
       if (_trparams._posradtrain == 1)
-        posx.push_back(img, ii_imgs, (int) _curState[0], (int) _curState[1], (int) _curState[2], (int) _curState[3]);
+      {
+        posx.setImage(img, ii);
+        posx.push_back(Sample((int) _curState[1], (int) _curState[0], (int) _curState[2], (int) _curState[3]));
+      }
       else
-        posx.sampleImage(img, ii_imgs, (int) _curState[0], (int) _curState[1], (int) _curState[2], (int) _curState[3],
-                         _trparams._posradtrain, 0, _trparams._posmaxtrain);
+        posx.sampleImage(img, ii, _rng, (int) _curState[0], (int) _curState[1], (int) _curState[2],
+                         (int) _curState[3], _trparams._posradtrain, 0, _trparams._posmaxtrain);
+      negx.setScale(_scale);
+      posx.setScale(_scale);
 
       _clf->update(posx, negx);
 
@@ -797,10 +1193,106 @@ namespace cv
       return resp;
     }
 
+    void
+    SimpleTracker::searchScales(const cv::Mat & img, const IntegralImage & ii)
+    {
+      // the candidate locations of _detectx, at the current scale, are shared by all the scales: each scaled box
+      // keeps the center of its candidate
+      SampleSet &detectx = _detectx;
+      int numscales = _trparams._scales.size();
+      int numsamples = detectx.size();
+      float ftrwidth = (float) _clfparams->_ftrParams->_width, ftrheight = (float) _clfparams->_ftrParams->_height;
+      _scalex.resize(numscales);
+      _scaleprob.resize(numscales);
+      _scalecand.resize(numscales);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (int i = 0; i < numscales; i++)
+      {
+        SampleSet &scalex = _scalex[i];
+        vectori &cand = _scalecand[i];
+        float scale = _scale * _trparams._scales[i];
+        int w = cvRound(ftrwidth * scale), h = cvRound(ftrheight * scale);
+        scalex.clear();
+        cand.clear();
+        scalex.setImage(img, ii);
+        scalex.setScale(scale);
+        if (w < 4 || h < 4)
+          continue;
+        for (int k = 0; k < numsamples; k++)
+        {
+          const Sample &s = detectx[k];
+          int col = cvRound(s._col + 0.5f * (s._width - w)), row = cvRound(s._row + 0.5f * (s._height - h));
+          // same bounds as sampleImage
+          if (col >= 0 && row >= 0 && col + w + 2 <= img.cols && row + h + 2 <= img.rows)
+          {
+            scalex.push_back(Sample(row, col, w, h));
+            cand.push_back(k);
+          }
+        }
+      }
+
+      int total = 0;
+      for (int i = 0; i < numscales; i++)
+        total += _scalex[i].size();
+      if (total == 0)
+      {
+        _candidate.clear();
+        _prob = _clf->classify(detectx, _trparams._useLogR);
+        return;
+      }
+
+      // each scale is classified in parallel over its samples
+      for (int i = 0; i < numscales; i++)
+        _scaleprob[i] = _clf->classify(_scalex[i], _trparams._useLogR);
+
+      // all the scales in _detectx and _prob
+      _candidate.clear();
+      for (int i = 0; i < numscales; i++)
+        for (int k = 0; k < (int) _scalecand[i].size(); k++)
+        {
+          const Sample &s = detectx[_scalecand[i][k]];
+          _candidate.push_back(cv::Point(s._col, s._row));
+        }
+      detectx.clear();
+      detectx.setImage(img, ii);
+      _prob.clear();
+      for (int i = 0; i < numscales; i++)
+      {
+        for (int k = 0; k < _scalex[i].size(); k++)
+          detectx.push_back(_scalex[i][k]);
+        _prob.insert(_prob.end(), _scaleprob[i].begin(), _scaleprob[i].end());
+        _scalex[i].clear();
+      }
+    }
+
+    void
+    SimpleTracker::storeResponse(int x, int y)
+    {
+      int srchwinsz = _trparams._srchwinsz;
+      // allocated once: the search window has the same size every frame
+      _respMap.create(2 * srchwinsz + 1, 2 * srchwinsz + 1);
+      _respMap.setTo(-std::numeric_limits<float>::max());
+      _respOrigin = cv::Point(x - srchwinsz, y - srchwinsz);
+
+      // after a scale search, _detectx holds the scaled boxes: they are mapped back to their candidate location
+      bool scaled = !_trparams._scales.empty() && !_candidate.empty();
+      for (int k = 0; k < _detectx.size(); k++)
+      {
+        cv::Point p = scaled ? _candidate[k] : cv::Point(_detectx[k]._col, _detectx[k]._row);
+        int r = p.y - _respOrigin.y, c = p.x - _respOrigin.x;
+        if (r >= 0 && c >= 0 && r < _respMap.rows && c < _respMap.cols)
+          _respMap(r, c) = std::max(_respMap(r, c), _prob[k]);
+      }
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     TrackerParams::TrackerParams()
     {
+      _seed = 0;
       _boxcolor.resize(3);
       _boxcolor[0] = 204;
       _boxcolor[1] = 25;
@@ -825,6 +1317,7 @@ namespace cv
       _srchwinsz = 30;
       _initstate.resize(4);
       _negsamplestrat = 1;
+      _storeResponse = false;
     }
 
   } // namespace mil
@@ -43,6 +43,7 @@
 #include <iostream>
 
 #include "object_tracker.h"
+#include "tracker_adapters.h"
 
 namespace cv
 {
@@ -64,6 +65,7 @@ namespace cv
     pos_radius_train_ = 4.0f;
     neg_num_train_ = 65;
     num_features_ = 250;
+    seed_ = 0;
   }
 
   //---------------------------------------------------------------------------
@@ -73,7 +75,8 @@ namespace cv
   {
     // Make sure a valid algorithm flag is used before storing it
     if ((algorithm != CV_ONLINEBOOSTING) && (algorithm != CV_SEMIONLINEBOOSTING) && (algorithm != CV_ONLINEMIL)
-        && (algorithm != CV_LINEMOD))
+        && (algorithm != CV_LINEMOD) && (algorithm != CV_TLD) && (algorithm != CV_CT)
+        && (algorithm != CV_BEYONDSEMIBOOSTING))
     {
       // Use CV_ERROR?
       std::cerr << "ObjectTrackerParams::ObjectTrackerParams(...) -- ERROR!  Invalid algorithm choice.\n";
@@ -93,6 +96,7 @@ namespace cv
     pos_radius_train_ = pos_radius_train;
     neg_num_train_ = neg_num_train;
     num_features_ = num_features;
+    seed_ = 0;
   }
 
   //
@@ -109,6 +113,163 @@ namespace cv
   {
   }
 
+  //---------------------------------------------------------------------------
+  void
+  TrackingAlgorithm::stage_times(std::vector<std::pair<std::string, float> > & stages) const
+  {
+    stages.clear();
+  }
+
+  //---------------------------------------------------------------------------
+  void
+  TrackingAlgorithm::import_gray(const cv::Mat & image, cv::Mat & gray)
+  {
+    // We want the internal version of the image to be gray-scale, so let's
+    // do that here.  We'll handle cases where the input is either RGB, RGBA,
+    // or already gray-scale.  I assume it's already 8-bit.  If not then 
+    // an error is thrown.  I'm not going to deal with converting properly
+    // from every data type since that shouldn't be happening.
+
+    // Make sure the input image pointer is valid
+    if (image.empty())
+    {
+      std::cerr << "TrackingAlgorithm::import_gray(...) -- ERROR!  Input image pointer is NULL!\n" << std::endl;
+      exit(0); // <--- CV_ERROR?
+    }
+
+    // Now bring it in as a gray-scale, 8-bit image.  The trackers only read
+    // their input, so a gray image is shared instead of copied.
+    if (image.channels() == 4)
+    {
+      cv::cvtColor(image, gray, CV_RGBA2GRAY);
+    }
+    else if (image.channels() == 3)
+    {
+      cv::cvtColor(image, gray, CV_RGB2GRAY);
+    }
+    else if (image.channels() == 1)
+    {
+      gray = image;
+    }
+    else
+    {
+      std::cerr << "TrackingAlgorithm::import_gray(...) -- ERROR!  Invalid number of channels for input image!\n"
+                << std::endl;
+      exit(0);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  void
+  TrackingAlgorithm::import_image(const cv::Mat & image)
+  {
+    import_gray(image, image_);
+  }
+
+  //
+  //
+  //
+
+  namespace
+  {
+    template<class T>
+      TrackingAlgorithm*
+      create_algorithm()
+      {
+        return new T();
+      }
+  }
+
+  namespace
+  {
+    std::map<std::string, TrackingAlgorithmRegistry::Factory>
+    make_registry()
+    {
+      std::map<std::string, TrackingAlgorithmRegistry::Factory> registry;
+      registry["onlineboosting"] = &create_algorithm<OnlineBoostingAlgorithm>;
+      registry["semionlineboosting"] = &create_algorithm<SemiOnlineBoostingAlgorithm>;
+      registry["beyondsemiboosting"] = &create_algorithm<BeyondSemiBoostingAlgorithm>;
+      registry["mil"] = &create_algorithm<OnlineMILAlgorithm>;
+      registry["linemod"] = &create_algorithm<LINEMODAlgorithm>;
+#ifdef HAVE_TLD
+      registry["tld"] = &create_algorithm<TLDAlgorithm>;
+#endif
+#ifdef HAVE_CT
+      registry["ct"] = &create_algorithm<CTAlgorithm>;
+#endif
+      return registry;
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  std::map<std::string, TrackingAlgorithmRegistry::Factory>&
+  TrackingAlgorithmRegistry::factories()
+  {
+    // Built-in algorithms are registered on first use rather than by static
+    // objects, which the linker would drop from the static library.  The
+    // initialization of a function-local static is thread-safe; add() is not,
+    // and is meant to be called before trackers are created.
+    static std::map<std::string, Factory> registry = make_registry();
+    return registry;
+  }
+
+  //---------------------------------------------------------------------------
+  void
+  TrackingAlgorithmRegistry::add(const std::string & name, Factory factory)
+  {
+    factories()[name] = factory;
+  }
+
+  //---------------------------------------------------------------------------
+  TrackingAlgorithm*
+  TrackingAlgorithmRegistry::create(const std::string & name)
+  {
+    std::map<std::string, Factory>::const_iterator it = factories().find(name);
+    if (it == factories().end())
+    {
+      return NULL;
+    }
+    return it->second();
+  }
+
+  //---------------------------------------------------------------------------
+  std::vector<std::string>
+  TrackingAlgorithmRegistry::names()
+  {
+    std::vector<std::string> result;
+    std::map<std::string, Factory>::const_iterator it;
+    for (it = factories().begin(); it != factories().end(); ++it)
+    {
+      result.push_back(it->first);
+    }
+    return result;
+  }
+
+  //---------------------------------------------------------------------------
+  std::string
+  TrackingAlgorithmRegistry::name_of(int algorithm)
+  {
+    switch (algorithm)
+    {
+      case ObjectTrackerParams::CV_ONLINEBOOSTING:
+        return "onlineboosting";
+      case ObjectTrackerParams::CV_SEMIONLINEBOOSTING:
+        return "semionlineboosting";
+      case ObjectTrackerParams::CV_ONLINEMIL:
+        return "mil";
+      case ObjectTrackerParams::CV_LINEMOD:
+        return "linemod";
+      case ObjectTrackerParams::CV_TLD:
+        return "tld";
+      case ObjectTrackerParams::CV_CT:
+        return "ct";
+      case ObjectTrackerParams::CV_BEYONDSEMIBOOSTING:
+        return "beyondsemiboosting";
+      default:
+        return "";
+    }
+  }
+
   //
   //
   //
@@ -233,43 +394,6 @@ namespace cv
     return !tracker_lost_;
   }
 
-  //---------------------------------------------------------------------------
-  void
-  OnlineBoostingAlgorithm::import_image(const cv::Mat & image)
-  {
-    // We want the internal version of the image to be gray-scale, so let's
-    // do that here.  We'll handle cases where the input is either RGB, RGBA,
-    // or already gray-scale.  I assume it's already 8-bit.  If not then 
-    // an error is thrown.  I'm not going to deal with converting properly
-    // from every data type since that shouldn't be happening.
-
-    // Make sure the input image pointer is valid
-    if (image.empty())
-    {
-      std::cerr << "OnlineBoostingAlgorithm::import_image(...) -- ERROR!  Input image pointer is NULL!\n" << std::endl;
-      exit(0); // <--- CV_ERROR?
-    }
-
-    // Now copy it in appropriately as a gray-scale, 8-bit image
-    if (image.channels() == 4)
-    {
-      cv::cvtColor(image, image_, CV_RGBA2GRAY);
-    }
-    else if (image.channels() == 3)
-    {
-      cv::cvtColor(image, image_, CV_RGB2GRAY);
-    }
-    else if (image.channels() == 1)
-    {
-      image.copyTo(image_);
-    }
-    else
-    {
-      std::cerr << "OnlineBoostingAlgorithm::import_image(...) -- ERROR!  Invalid number of channels for input image!\n"
-                << std::endl;
-      exit(0);
-    }
-  }
   //
   //
   //
@@ -394,43 +518,6 @@ namespace cv
     return !tracker_lost_;
   }
 
-  //---------------------------------------------------------------------------
-  void
-  SemiOnlineBoostingAlgorithm::import_image(const cv::Mat & image)
-  {
-    // We want the internal version of the image to be gray-scale, so let's
-    // do that here.  We'll handle cases where the input is either RGB, RGBA,
-    // or already gray-scale.  I assume it's already 8-bit.  If not then 
-    // an error is thrown.  I'm not going to deal with converting properly
-    // from every data type since that shouldn't be happening.
-
-    // Make sure the input image pointer is valid
-    if (image.empty())
-    {
-      std::cerr << "OnlineBoostingAlgorithm::import_image(...) -- ERROR!  Input image pointer is NULL!\n" << std::endl;
-      exit(0); // <--- CV_ERROR?
-    }
-
-    // Now copy it in appropriately as a gray-scale, 8-bit image
-    if (image.channels() == 4)
-    {
-      cv::cvtColor(image, image_, CV_RGBA2GRAY);
-    }
-    else if (image.channels() == 3)
-    {
-      cv::cvtColor(image, image_, CV_RGB2GRAY);
-    }
-    else if (image.channels() == 1)
-    {
-      image.copyTo(image_);
-    }
-    else
-    {
-      std::cerr << "OnlineBoostingAlgorithm::import_image(...) -- ERROR!  Invalid number of channels for input image!\n"
-                << std::endl;
-      exit(0);
-    }
-  }
 
   //
   //
@@ -442,7 +529,6 @@ namespace cv
         TrackingAlgorithm(),
         is_initialized(false)
   {
-    cv::mil::RandomGenerator::initialize((int) time(0));
     clfparams_ = new cv::mil::ClfMilBoostParams();
     ftrparams_ = &haarparams_;
     clfparams_->_ftrParams = ftrparams_;
@@ -465,6 +551,8 @@ namespace cv
     ((cv::mil::ClfMilBoostParams*) clfparams_)->_numFeat = params.num_features_;
     tracker_params_._posradtrain = params.pos_radius_train_;
     tracker_params_._negnumtrain = params.neg_num_train_;
+    // every tracker has its own random streams, reproducible unless the seed asks for time(0)
+    clfparams_->_seed = tracker_params_._seed = params.seed_ < 0 ? (uint64) time(0) : (uint64) params.seed_;
 
     // Tracking parameters
     tracker_params_._init_negnumtrain = 65;
@@ -511,43 +599,6 @@ namespace cv
     return true;
   }
 
-  //---------------------------------------------------------------------------
-  void
-  OnlineMILAlgorithm::import_image(const cv::Mat & image)
-  {
-    // We want the internal version of the image to be gray-scale, so let's
-    // do that here.  We'll handle cases where the input is either RGB, RGBA,
-    // or already gray-scale.  I assume it's already 8-bit.  If not then 
-    // an error is thrown.  I'm not going to deal with converting properly
-    // from every data type since that shouldn't be happening.
-
-    // Make sure the input image pointer is valid
-    if (image.empty())
-    {
-      std::cerr << "OnlineBoostingAlgorithm::import_image(...) -- ERROR!  Input image pointer is NULL!\n" << std::endl;
-      exit(0); // <--- CV_ERROR?
-    }
-
-    // Now copy it in appropriately as a gray-scale, 8-bit image
-    if (image.channels() == 4)
-    {
-      cv::cvtColor(image, image_, CV_RGBA2GRAY);
-    }
-    else if (image.channels() == 3)
-    {
-      cv::cvtColor(image, image_, CV_RGB2GRAY);
-    }
-    else if (image.channels() == 1)
-    {
-      image.copyTo(image_);
-    }
-    else
-    {
-      std::cerr << "OnlineBoostingAlgorithm::import_image(...) -- ERROR!  Invalid number of channels for input image!\n"
-                << std::endl;
-      exit(0);
-    }
-  }
 
   //
   //
@@ -603,26 +654,31 @@ namespace cv
 
     // Allocate the proper tracking algorithm (note: error-checking that a valid
     // tracking algorithm parameter is used is done in the ObjectTrackerParams
-    // constructor, so at this point we are confident it's valid).
-    switch (params.algorithm_)
+    // constructor, so at this point we are confident it's valid, though it may
+    // not be compiled in).
+    tracker_ = TrackingAlgorithmRegistry::create(TrackingAlgorithmRegistry::name_of(params.algorithm_));
+    if (tracker_ == NULL)
     {
-      case ObjectTrackerParams::CV_ONLINEBOOSTING:
-        tracker_ = new OnlineBoostingAlgorithm();
-        break;
-      case ObjectTrackerParams::CV_SEMIONLINEBOOSTING:
-        tracker_ = new SemiOnlineBoostingAlgorithm();
-        break;
-      case ObjectTrackerParams::CV_ONLINEMIL:
-        tracker_ = new OnlineMILAlgorithm();
-        break;
-      case ObjectTrackerParams::CV_LINEMOD:
-        tracker_ = new LINEMODAlgorithm();
-        break;
-      default:
-        // By default, if an invalid choice somehow gets through lets use online boosting?
-        // Or throw an error and don't continue?
-        tracker_ = new OnlineBoostingAlgorithm();
-        break;
+      // By default, if an invalid choice somehow gets through lets use online boosting?
+      // Or throw an error and don't continue?
+      std::cerr << "ObjectTracker::ObjectTracker(...) -- WARNING!  Algorithm not available, using online boosting.\n";
+      tracker_ = new OnlineBoostingAlgorithm();
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  ObjectTracker::ObjectTracker(const std::string & algorithm, const ObjectTrackerParams& params)
+      :
+        initialized_(false),
+        tracker_(NULL)
+  {
+    set_params(params);
+
+    tracker_ = TrackingAlgorithmRegistry::create(algorithm);
+    if (tracker_ == NULL)
+    {
+      std::cerr << "ObjectTracker::ObjectTracker(...) -- ERROR!  Unknown tracking algorithm '" << algorithm << "'.\n";
+      exit(-1);
     }
   }
 
@@ -0,0 +1,327 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//                For Open Source Computer Vision Library
+//
+// Copyright (C) 2000-2008, Intel Corporation, all rights reserved.
+// Copyright (C) 2009-2011, Willow Garage Inc., all rights reserved.
+// Third party copyrights are property of their respective owners.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//   * Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//   * Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   * The name of the copyright holders may not be used to endorse or promote products
+//     derived from this software without specific prior written permission.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the Intel Corporation or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+//
+//M*/
+
+#include <iostream>
+
+#include "tracker_adapters.h"
+
+namespace cv
+{
+  //---------------------------------------------------------------------------
+  BeyondSemiBoostingAlgorithm::BeyondSemiBoostingAlgorithm()
+      :
+        TrackingAlgorithm(),
+        tracker_lost_(false)
+  {
+  }
+
+  //---------------------------------------------------------------------------
+  BeyondSemiBoostingAlgorithm::~BeyondSemiBoostingAlgorithm()
+  {
+  }
+
+  //---------------------------------------------------------------------------
+  bool
+  BeyondSemiBoostingAlgorithm::initialize(const cv::Mat & image, const ObjectTrackerParams& params,
+                                          const CvRect& init_bounding_box)
+  {
+    import_image(image);
+
+    cv::Size imageSize(image_.cols, image_.rows);
+    cv::Rect wholeImage = cv::Rect(0, 0, imageSize.width, imageSize.height);
+    cv::Rect tracking_rect = cv::Rect(init_bounding_box) & wholeImage;
+    if (tracking_rect.area() == 0)
+    {
+      std::cerr << "BeyondSemiBoostingAlgorithm::initialize(...) -- ERROR!  Bounding box outside the image.\n";
+      return false;
+    }
+    tracking_rect_size_ = tracking_rect.size();
+
+    // The first background covers the object with the top left corner of the frame
+    image_.copyTo(background_);
+    cv::Mat object_region = background_(tracking_rect);
+    image_(cv::Rect(0, 0, tracking_rect.width, tracking_rect.height)).copyTo(object_region);
+
+    cur_frame_rep_ = new boosting::ImageRepresentation(image_, imageSize);
+    background_rep_ = new boosting::ImageRepresentation(background_, imageSize);
+    tracker_ = new boosting::BeyondSemiBoostingTracker(cur_frame_rep_, background_rep_, tracking_rect, wholeImage,
+                                                       params.num_classifiers_);
+    tracker_lost_ = false;
+
+    // Return success
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  bool
+  BeyondSemiBoostingAlgorithm::update(const cv::Mat & image, const ObjectTrackerParams& params,
+                                      cv::Rect & track_box)
+  {
+    if (tracker_.empty())
+    {
+      std::cerr << "BeyondSemiBoostingAlgorithm::update(...) -- ERROR!  Trying to call update without properly "
+                   "initializing the tracker!\n";
+      return false;
+    }
+    import_image(image);
+
+    // Calculate the patches within the search region, the whole frame after a loss
+    cv::Rect wholeImage = cv::Rect(0, 0, image_.cols, image_.rows);
+    cv::Rect searchRegion = wholeImage;
+    float overlap = 0.98f;
+    if (!tracker_lost_)
+    {
+      searchRegion = tracker_->getTrackingROI(params.search_factor_);
+      overlap = params.overlap_;
+    }
+    boosting::PatchesRegularScan trackingPatches(searchRegion, wholeImage, tracking_rect_size_, overlap);
+
+    cur_frame_rep_->setNewImageAndROI(image_, searchRegion);
+    background_rep_->setNewImageAndROI(background_, searchRegion);
+
+    tracker_lost_ = !tracker_->track(cur_frame_rep_, background_rep_, &trackingPatches);
+    if (!tracker_lost_)
+    {
+      // Refresh the background everywhere but inside the tracked box
+      cv::Rect tracked = tracker_->getTrackedPatch();
+      cv::Rect inside = cv::Rect(tracked.x + 1, tracked.y + 1, tracked.width - 1, tracked.height - 1) & wholeImage;
+      cv::Mat object;
+      if (inside.area() > 0)
+        background_(inside).copyTo(object);
+      image_.copyTo(background_);
+      if (!object.empty())
+      {
+        cv::Mat object_region = background_(inside);
+        object.copyTo(object_region);
+      }
+    }
+
+    // Save the new tracking ROI
+    track_box = tracker_->getTrackedPatch();
+
+    // Return success or failure based on whether or not the tracker has been lost
+    return !tracker_lost_;
+  }
+
+  //
+  //
+  //
+
+
+#ifdef HAVE_TLD
+  namespace
+  {
+    // TLD/c++/parameters.yml, without the initial bounding box.  Learning stays on the
+    // calling thread so that update() times the whole TLD frame.
+    const char* tld_default_parameters =
+        "%YAML:1.0\n"
+        "Parameters:\n"
+        "   min_win: 15\n"
+        "   patch_size: 15\n"
+        "   ncc_thesame: 0.95\n"
+        "   valid: 0.5\n"
+        "   num_trees: 10\n"
+        "   num_features: 13\n"
+        "   thr_fern: 0.6\n"
+        "   thr_nn: 0.65\n"
+        "   thr_nn_valid: 0.7\n"
+        "   nn_int8: 0\n"
+        "   nn_int8_check: 0\n"
+        "   num_closest_init: 10\n"
+        "   num_warps_init: 20\n"
+        "   noise_init: 5\n"
+        "   angle_init: 20\n"
+        "   shift_init: 0.02\n"
+        "   scale_init: 0.02\n"
+        "   num_closest_update: 10\n"
+        "   num_warps_update: 10\n"
+        "   noise_update: 5\n"
+        "   angle_update: 10\n"
+        "   shift_update: 0.02\n"
+        "   scale_update: 0.02\n"
+        "   overlap: 0.2\n"
+        "   num_patches: 100\n"
+        "   budget_mode: 0\n"
+        "   budget_full_every: 5\n"
+        "   budget_grid_parts: 4\n"
+        "   budget_nn: 30\n"
+        "   async_learning: 0\n";
+  }
+
+  //---------------------------------------------------------------------------
+  TLDAlgorithm::TLDAlgorithm()
+      :
+        TrackingAlgorithm(),
+        found_(false)
+  {
+  }
+
+  //---------------------------------------------------------------------------
+  TLDAlgorithm::~TLDAlgorithm()
+  {
+  }
+
+  //---------------------------------------------------------------------------
+  bool
+  TLDAlgorithm::initialize(const cv::Mat & image, const ObjectTrackerParams& params,
+                           const CvRect& init_bounding_box)
+  {
+    cv::FileStorage fs;
+    if (params.config_file_.empty())
+    {
+      fs.open(tld_default_parameters, cv::FileStorage::READ + cv::FileStorage::MEMORY);
+    }
+    else if (!fs.open(params.config_file_, cv::FileStorage::READ))
+    {
+      std::cerr << "TLDAlgorithm::initialize(...) -- ERROR!  Could not open " << params.config_file_ << ".\n";
+      return false;
+    }
+    cv::FileNode file = fs.getFirstTopLevelNode();
+
+    cv::Rect box(init_bounding_box);
+    if (std::min(box.width, box.height) < (int)file["min_win"])
+    {
+      std::cerr << "TLDAlgorithm::initialize(...) -- ERROR!  Bounding box too small.\n";
+      return false;
+    }
+
+    import_image(image);
+    tld_.read(file);
+    tld_.init(image_, box, NULL);
+
+    // The caller may reuse the buffer of a gray input
+    image_.copyTo(last_gray_);
+    found_ = true;
+
+    // Return success
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  bool
+  TLDAlgorithm::update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box)
+  {
+    import_image(image);
+
+    std::vector<cv::Point2f> points1;
+    std::vector<cv::Point2f> points2;
+    BoundingBox box;
+    tld_.processFrame(last_gray_, image_, points1, points2, box, found_, true, NULL);
+    image_.copyTo(last_gray_);
+
+    // Save output
+    if (found_)
+    {
+      track_box = box;
+    }
+
+    // Return success or failure based on whether or not the object was found
+    return found_;
+  }
+
+  //---------------------------------------------------------------------------
+  void
+  TLDAlgorithm::stage_times(std::vector<std::pair<std::string, float> > & stages) const
+  {
+    stages.clear();
+#ifdef TLD_METRICS
+    const MetricsLog& log = tld_.getMetrics();
+    if (log.size() == 0)
+    {
+      return;
+    }
+    const FrameMetrics& m = log.at(log.size() - 1);
+    stages.push_back(std::make_pair(std::string("track"), m.track_ms));
+    stages.push_back(std::make_pair(std::string("detect"), m.fern_ms));
+    stages.push_back(std::make_pair(std::string("nn"), m.nn_ms));
+    stages.push_back(std::make_pair(std::string("cluster"), m.cluster_ms));
+    stages.push_back(std::make_pair(std::string("learn"), m.learn_ms));
+#endif
+  }
+#endif
+
+  //
+  //
+  //
+
+#ifdef HAVE_CT
+  //---------------------------------------------------------------------------
+  CTAlgorithm::CTAlgorithm()
+      :
+        TrackingAlgorithm()
+  {
+  }
+
+  //---------------------------------------------------------------------------
+  CTAlgorithm::~CTAlgorithm()
+  {
+  }
+
+  //---------------------------------------------------------------------------
+  bool
+  CTAlgorithm::initialize(const cv::Mat & image, const ObjectTrackerParams& params,
+                          const CvRect& init_bounding_box)
+  {
+    import_image(image);
+    box_ = init_bounding_box;
+    tracker_.init(image_, box_);
+
+    // Return success
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  bool
+  CTAlgorithm::update(const cv::Mat & image, const ObjectTrackerParams& params, cv::Rect & track_box)
+  {
+    import_image(image);
+    tracker_.processFrame(image_, box_);
+
+    // Save output
+    track_box = box_;
+
+    // Return success (CT always reports a box)
+    return true;
+  }
+#endif
+
+}
@@ -56,6 +56,35 @@ void CompressiveTracker::HaarFeature(Rect& _objectBox, int _numFeature)
            
 		}
 	}
+	compileFeatures();
+}
+
+// Rebuild the feature table from features and featuresWeight
+void CompressiveTracker::compileFeatures()
+{
+	featureTable.clear();
+	for (size_t i=0; i<features.size(); i++)
+	{
+		featureTable.add_feature();
+		for (size_t k=0; k<features[i].size(); k++)
+		{
+			featureTable.add_rect(features[i][k].x, features[i][k].y, features[i][k].width, features[i][k].height,
+				featuresWeight[i][k]);
+		}
+	}
+}
+
+// Integral image (CV_32F) of the frame
+void CompressiveTracker::integralImage(Mat& _frame, Mat& _imageIntegral)
+{
+	if (_frame.type() != CV_8UC1)
+	{
+		integral(_frame, _imageIntegral, CV_32F);
+		return;
+	}
+	_imageIntegral.create(_frame.rows+1, _frame.cols+1, CV_32F);
+	haar::integral(_frame.ptr<uchar>(), _frame.cols, _frame.rows, (int)_frame.step,
+		_imageIntegral.ptr<float>(), (int)_imageIntegral.step1());
 }
 
 
@@ -159,37 +188,33 @@ void CompressiveTracker::sampleRect(Mat& _image, Rect& _objectBox, float _srw, v
 		_sampleBox.resize(i);
 
 }
+// Replace the random features
+void CompressiveTracker::setFeatures(const vector<vector<Rect>>& _features, const vector<vector<float>>& _featuresWeight)
+{
+	features = _features;
+	featuresWeight = _featuresWeight;
+	featureNum = (int)features.size();
+	compileFeatures();
+}
+
 // Compute the features of samples
 void CompressiveTracker::getFeatureValue(Mat& _imageIntegral, vector<Rect>& _sampleBox, Mat& _sampleFeatureValue)
 {
 	int sampleBoxSize = _sampleBox.size();
 	_sampleFeatureValue.create(featureNum, sampleBoxSize, CV_32F);
-	float tempValue;
-	int xMin;
-	int xMax;
-	int yMin;
-	int yMax;
+	if (sampleBoxSize == 0)
+	{
+		return;
+	}
 
-	for (int i=0; i<featureNum; i++)
+	featureTable.compile((int)_imageIntegral.step1());
+	sampleOffset.resize(sampleBoxSize);
+	for (int j=0; j<sampleBoxSize; j++)
 	{
-		for (int j=0; j<sampleBoxSize; j++)
-		{
-			tempValue = 0.0f;
-			for (size_t k=0; k<features[i].size(); k++)
-			{
-				xMin = _sampleBox[j].x + features[i][k].x;
-				xMax = _sampleBox[j].x + features[i][k].x + features[i][k].width;
-				yMin = _sampleBox[j].y + features[i][k].y;
-				yMax = _sampleBox[j].y + features[i][k].y + features[i][k].height;
-				tempValue += featuresWeight[i][k] * 
-					(_imageIntegral.at<float>(yMin, xMin) +
-					_imageIntegral.at<float>(yMax, xMax) -
-					_imageIntegral.at<float>(yMin, xMax) -
-					_imageIntegral.at<float>(yMax, xMin));
-			}
-			_sampleFeatureValue.at<float>(i,j) = tempValue;
-		}
+		sampleOffset[j] = featureTable.offset(_sampleBox[j].x, _sampleBox[j].y);
 	}
+	featureTable.evaluate(_imageIntegral.ptr<float>(), &sampleOffset[0], sampleBoxSize,
+		_sampleFeatureValue.ptr<float>(), _sampleFeatureValue.step1());
 }
 
 // Update the mean and variance of the gaussian classifier
@@ -245,7 +270,7 @@ void CompressiveTracker::init(Mat& _frame, Rect& _objectBox)
 	sampleRect(_frame, _objectBox, rOuterPositive, 0, 1000000, samplePositiveBox);
 	sampleRect(_frame, _objectBox, rSearchWindow*1.5, rOuterPositive+4.0, 100, sampleNegativeBox);
 
-	integral(_frame, imageIntegral, CV_32F);
+	integralImage(_frame, imageIntegral);
 
 	getFeatureValue(imageIntegral, samplePositiveBox, samplePositiveFeatureValue);
 	getFeatureValue(imageIntegral, sampleNegativeBox, sampleNegativeFeatureValue);
@@ -256,7 +281,7 @@ void CompressiveTracker::processFrame(Mat& _frame, Rect& _objectBox)
 {
 	// predict
 	sampleRect(_frame, _objectBox, rSearchWindow,detectBox);
-	integral(_frame, imageIntegral, CV_32F);
+	integralImage(_frame, imageIntegral);
 	getFeatureValue(imageIntegral, detectBox, detectFeatureValue);
 	int radioMaxIndex;
 	float radioMax;
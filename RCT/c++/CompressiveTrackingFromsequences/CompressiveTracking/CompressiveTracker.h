@@ -15,6 +15,7 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <vector>
+#include "haar_features.h"
 
 using std::vector;
 using namespace cv;
@@ -31,6 +32,8 @@ private:
 	int featureNum;
 	vector<vector<Rect>> features;
 	vector<vector<float>> featuresWeight;
+	haar::FeatureTable featureTable;
+	vector<int> sampleOffset;
 	int rOuterPositive;
 	vector<Rect> samplePositiveBox;
 	vector<Rect> sampleNegativeBox;
@@ -49,13 +52,17 @@ private:
 
 private:
 	void HaarFeature(Rect& _objectBox, int _numFeature);
+	void compileFeatures();
+	void integralImage(Mat& _frame, Mat& _imageIntegral);
 	void sampleRect(Mat& _image, Rect& _objectBox, float _rInner, float _rOuter, int _maxSampleNum, vector<Rect>& _sampleBox);
 	void sampleRect(Mat& _image, Rect& _objectBox, float _srw, vector<Rect>& _sampleBox);
-	void getFeatureValue(Mat& _imageIntegral, vector<Rect>& _sampleBox, Mat& _sampleFeatureValue);
 	void classifierUpdate(Mat& _sampleFeatureValue, vector<float>& _mu, vector<float>& _sigma, float _learnRate);
 	void radioClassifier(vector<float>& _muPos, vector<float>& _sigmaPos, vector<float>& _muNeg, vector<float>& _sigmaNeg,
 						Mat& _sampleFeatureValue, float& _radioMax, int& _radioMaxIndex);
 public:
 	void processFrame(Mat& _frame, Rect& _objectBox);
 	void init(Mat& _frame, Rect& _objectBox);
+	// Feature evaluation on its own (kernel benchmarks)
+	void setFeatures(const vector<vector<Rect>>& _features, const vector<vector<float>>& _featuresWeight);
+	void getFeatureValue(Mat& _imageIntegral, vector<Rect>& _sampleBox, Mat& _sampleFeatureValue);
 };
@@ -0,0 +1,93 @@
+#include "haar_core.h"
+// compute integral img
+// s(i,j) = s(i-1,j)+i(i,j)
+// ii(i,j) = ii(i,j-1)+s(i,j)
+// s(i,j) = s(i+j*M);
+// s(0,j) = i(0,j);ii(i,0)=s(i,0)
+
+void integral(
+				   double	ii[],
+				   const double	*img,
+				   int M,
+				   int N)
+{
+	int i;
+	int j;
+	double *s = new double[M*N];
+
+	for(j=0; j<N; j++)
+	{
+		s[j*M] = img[j*M];
+		for(i=1; i<M; i++)
+		{
+			s[i+j*M] = s[i-1+j*M] + img[i+j*M];
+		}
+
+	}
+	
+
+	for(i=0; i<M; i++)
+	{
+		ii[i] = s[i];
+		for(j=1; j<N; j++)
+		{
+			
+			ii[i+j*M] = ii[i+(j-1)*M] + s[i+j*M];
+
+		}
+	}
+
+		
+	delete []s;
+	return;
+}
+
+void getFtrVal(double samplesFtrVal[],const double*iH,const double *sx,const double * sy,const double *px, const double *py, const double *pw,
+					  const double *ph, const double *pwt, int len_F,int len_S,int len_R,int M,int N)
+
+{
+   	int i,j,minJ,maxJ,minI,maxI;
+    int m,k;
+	int x,y;
+    int *temp = new int[len_F];
+	for(i=0;i<len_F; i++)
+	{
+	   m=0;
+       for(j=0;j<len_R;j++)
+	   {
+		   if(px[i+j*len_F]!=0)
+		   {
+			   m = m+1;
+		   }
+		   else
+		   {
+			   break;
+		   }
+
+	   }
+	   temp[i] = m;
+	}
+
+    for(i=0;i<len_F;i++)
+       for(j=0;j<len_S;j++)
+	   {
+	     m = 0;
+		 x = sx[j];
+		 y = sy[j];
+
+		 for(k=0;k<temp[i];k++)
+		 {
+			 minJ = x-1+px[i+k*len_F];
+             maxJ = x-1+px[i+k*len_F]+pw[i+k*len_F]-1;
+             minI = y-1+py[i+k*len_F];
+             maxI = y-1+py[i+k*len_F]+ph[i+k*len_F]-1;
+
+			 m = m+pwt[i+k*len_F]*(iH[minI+minJ*M]+iH[maxI+maxJ*M]
+			 -iH[maxI+minJ*M]-iH[minI+maxJ*M]);
+
+		 }
+		 samplesFtrVal[i+j*len_F]=m;
+	   }
+   delete []temp;
+       
+}          
@@ -0,0 +1,14 @@
+// Integral image and Haar feature kernels of the MEX files, free of MATLAB.
+// All matrices are column-major (MATLAB layout) and coordinates 1-based.
+
+#pragma once
+
+// ii (M x N) = integral image of img (M x N), ii(i,j) = sum of img(1..i,1..j)
+void integral(double ii[], const double *img, int M, int N);
+
+// samplesFtrVal (len_F x len_S) = Haar features of the samples at (sx,sy) on the integral image iH (M x N).
+// px,py,pw,ph,pwt (len_F x len_R) are the rectangles and weights of each feature, a feature ending at its
+// first rectangle with px == 0. Values are accumulated in integers.
+void getFtrVal(double samplesFtrVal[], const double *iH, const double *sx, const double *sy, const double *px,
+			   const double *py, const double *pw, const double *ph, const double *pwt, int len_F, int len_S,
+			   int len_R, int M, int N);
@@ -1,5 +1,6 @@
 #include <math.h>
 #include "mex.h"
+#include "core/haar_core.h"
 // compute integral img
 // s(i,j) = s(i-1,j)+i(i,j)
 // ii(i,j) = ii(i,j-1)+s(i,j)
@@ -14,43 +15,6 @@
 #define	ii_OUT	plhs[0]
 
 
-static void integral(
-				   double	ii[],
-				   double	*img,
-				   int M,
-				   int N)
-{
-	int i;
-	int j;
-	double *s = new double[M*N];
-
-	for(j=0; j<N; j++)
-	{
-		s[j*M] = img[j*M];
-		for(i=1; i<M; i++)
-		{
-			s[i+j*M] = s[i-1+j*M] + img[i+j*M];
-		}
-
-	}
-	
-
-	for(i=0; i<M; i++)
-	{
-		ii[i] = s[i];
-		for(j=1; j<N; j++)
-		{
-			
-			ii[i+j*M] = ii[i+(j-1)*M] + s[i+j*M];
-
-		}
-	}
-
-		
-	delete []s;
-	return;
-}
-
 void mexFunction( int nlhs, mxArray *plhs[], 
 				 int nrhs, const mxArray*prhs[] )
 
@@ -1,2 +1,2 @@
-mex integral.cpp;
-mex FtrVal.cpp;
\ No newline at end of file
+mex integral.cpp core/haar_core.cpp;
+mex FtrVal.cpp core/haar_core.cpp;
@@ -6,8 +6,50 @@
  */
 
 #include <opencv2/opencv.hpp>
+#include <tld_utils.h>
 #include <stdio.h>
+#include <memory>
+
+//int8 zero-mean NN patterns, one zero-padded row of stride bytes (multiple of 16) per pattern
+struct QuantizedPatterns{
+  QuantizedPatterns():rows(0),cols(0),stride(0){}
+  int rows, cols;              //pattern shape
+  int stride;
+  std::vector<schar> data;
+  std::vector<float> norm;     //L2 norm of each int8 row
+  std::vector<float> scale;    //int8 = round(float*scale)
+  int size() const {return (int)norm.size();}
+  const schar* row(int i) const {return &data[(size_t)i*stride];}
+  void clear();
+  void push_back(const cv::Mat& pattern);
+  cv::Mat unpack(int i) const;
+  float ncc(int i,const schar* q,float qnorm) const;
+};
+//Quantizes a CV_32F pattern into stride bytes; returns its scale and the norm of the int8 values
+void quantizePattern(const cv::Mat& pattern,schar* dst,int stride,float& scale,float& norm);
+//Integer dot product of two int8 rows (stride multiple of 16)
+int dotInt8(const schar* a,const schar* b,int stride);
+
 class FerNNClassifier{
+public:
+  struct Feature
+      {
+          uchar x1, y1, x2, y2;
+          Feature() : x1(0), y1(0), x2(0), y2(0) {}
+          Feature(int _x1, int _y1, int _x2, int _y2)
+          : x1((uchar)_x1), y1((uchar)_y1), x2((uchar)_x2), y2((uchar)_y2)
+          {}
+          bool operator ()(const cv::Mat& patch) const
+          { return patch.at<uchar>(y1,x1) > patch.at<uchar>(y2, x2); }
+      };
+  typedef std::vector<std::vector<Feature> > FeatureSet;   //one std::vector for each scale
+  typedef std::vector<std::vector<float> > Posteriors;     //one std::vector for each fern
+  struct NNExamples{
+    std::vector<cv::Mat> pEx; //NN positive examples
+    std::vector<cv::Mat> nEx; //NN negative examples
+    QuantizedPatterns pExQ;   //int8 positive examples (nn_int8)
+    QuantizedPatterns nExQ;   //int8 negative examples (nn_int8)
+  };
 private:
   float thr_fern;
   int structSize;
@@ -16,41 +58,51 @@ private:
   float ncc_thesame;
   float thr_nn;
   int acum;
+  int nn_int8;        //NN examples stored and compared as int8 patterns
+  int nn_int8_check;  //keep the float examples too, to measure the int8 error
+  std::shared_ptr<MappedFile> storage; //keeps memory-mapped NN examples alive
+  //What the detector reads, shared with the snapshots (copy-on-write: training copies a block
+  //a snapshot still holds before writing it). features never changes after prepare()/load().
+  std::shared_ptr<const FeatureSet> features;
+  std::shared_ptr<Posteriors> posteriors;
+  std::shared_ptr<NNExamples> examples;
+  //Training only, not in the snapshots
+  std::vector< std::vector<int> > nCounter; //negative counter
+  std::vector< std::vector<int> > pCounter; //positive counter
+  Posteriors& mutablePosteriors();
+  NNExamples& mutableExamples();
+  void NNConf(const cv::Mat& example,std::vector<int>& isin,float& rsconf,float& csconf,bool quantized) const;
+  void addExample(const cv::Mat& example,bool positive);
+  void floatExamples(std::vector<cv::Mat>& pos,std::vector<cv::Mat>& neg) const;
 public:
   //Parameters
   float thr_nn_valid;
 
+  FerNNClassifier();
   void read(const cv::FileNode& file);
   void prepare(const std::vector<cv::Size>& scales);
-  void getFeatures(const cv::Mat& image,const int& scale_idx,std::vector<int>& fern);
+  void getFeatures(const cv::Mat& image,const int& scale_idx,std::vector<int>& fern) const;
   void update(const std::vector<int>& fern, int C, int N);
-  float measure_forest(std::vector<int> fern);
+  float measure_forest(const std::vector<int>& fern) const;
   void trainF(const std::vector<std::pair<std::vector<int>,int> >& ferns,int resample);
   void trainNN(const std::vector<cv::Mat>& nn_examples);
-  void NNConf(const cv::Mat& example,std::vector<int>& isin,float& rsconf,float& csconf);
+  void NNConf(const cv::Mat& example,std::vector<int>& isin,float& rsconf,float& csconf) const;
+  float NNConfError(const cv::Mat& example) const;
   void evaluateTh(const std::vector<std::pair<std::vector<int>,int> >& nXT,const std::vector<cv::Mat>& nExT);
-  void show();
+  void show() const;
+  //Read-only model for the detector: parameters, thresholds and the shared features, posteriors and
+  //NN examples, without the fern counters (so it cannot be trained or saved)
+  std::shared_ptr<const FerNNClassifier> snapshot() const;
+  //Binary model section (see TLD::saveModel)
+  bool save(FILE* f) const;
+  //Fails unless the section has nscales fern scales and patch_size x patch_size NN examples
+  bool load(const std::shared_ptr<MappedFile>& file,size_t& offset,int nscales,int patch_size);
   //Ferns Members
-  int getNumStructs(){return nstructs;}
-  float getFernTh(){return thr_fern;}
-  float getNNTh(){return thr_nn;}
-  struct Feature
-      {
-          uchar x1, y1, x2, y2;
-          Feature() : x1(0), y1(0), x2(0), y2(0) {}
-          Feature(int _x1, int _y1, int _x2, int _y2)
-          : x1((uchar)_x1), y1((uchar)_y1), x2((uchar)_x2), y2((uchar)_y2)
-          {}
-          bool operator ()(const cv::Mat& patch) const
-          { return patch.at<uchar>(y1,x1) > patch.at<uchar>(y2, x2); }
-      };
-  std::vector<std::vector<Feature> > features; //Ferns features (one std::vector for each scale)
-  std::vector< std::vector<int> > nCounter; //negative counter
-  std::vector< std::vector<int> > pCounter; //positive counter
-  std::vector< std::vector<float> > posteriors; //Ferns posteriors
+  int getNumStructs() const {return nstructs;}
+  float getFernTh() const {return thr_fern;}
+  float getNNTh() const {return thr_nn;}
+  int numPositive() const {return nn_int8 ? examples->pExQ.size() : (int)examples->pEx.size();}
+  int numNegative() const {return nn_int8 ? examples->nExQ.size() : (int)examples->nEx.size();}
   float thrN; //Negative threshold
   float thrP;  //Positive thershold
-  //NN Members
-  std::vector<cv::Mat> pEx; //NN positive examples
-  std::vector<cv::Mat> nEx; //NN negative examples
 };
@@ -2,7 +2,12 @@
 #include <tld_utils.h>
 #include <LKTracker.h>
 #include <FerNNClassifier.h>
+#include <tld_metrics.h>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
 
 
 //Bounding Boxes
@@ -29,6 +34,33 @@ struct DetStruct {
     std::vector<float> conf;
   };
 
+//Snapshot of the frame data consumed by the learning stage
+struct LearnJob {
+  cv::Mat img;                                //current frame
+  BoundingBox box;                            //validated object box
+  std::vector<int> hard_idx;                  //grid indexes with fern confidence >= 1
+  std::vector<std::vector<int> > hard_patt;   //and their fern codes
+  std::vector<int> det_idx;                   //grid indexes sent to the NN classifier
+  std::vector<cv::Mat> det_patch;             //and their NN patterns
+};
+
+//Per-frame budget report (what the deadline mode skipped)
+struct FrameReport {
+  FrameReport():tracked(false),full_detection(true),scanned_boxes(0),skipped_boxes(0),
+      nn_candidates(0),nn_dropped(0),learned(false),learning_deferred(false),deferred_failed(false),
+      deferred_dropped(false){}
+  bool tracked;           //LK tracker produced a box
+  bool full_detection;    //whole grid was scanned
+  int scanned_boxes;      //grid boxes visited by the detector
+  int skipped_boxes;      //grid boxes left out of this frame's scan
+  int nn_candidates;      //fern detections evaluated by the NN classifier
+  int nn_dropped;         //fern detections dropped by the NN budget
+  bool learned;           //an update ran on this frame (its own or the one deferred by an earlier frame)
+  bool learning_deferred; //this frame's learning data was snapshotted, the update runs on the next partial frame
+  bool deferred_failed;   //the deferred update that ran on this frame found no good boxes
+  bool deferred_dropped;  //a full frame dropped the pending deferred update and learned its own data inline
+};
+
 struct OComparator{
   OComparator(const std::vector<BoundingBox>& _grid):grid(_grid){}
   std::vector<BoundingBox> grid;
@@ -71,6 +103,12 @@ private:
   //parameters for negative examples
   float bad_overlap;
   float bad_patches;
+  //deadline mode parameters
+  int budget_mode;       //0: always run the full detector, 1: bounded latency
+  int budget_full_every; //full detection is guaranteed every N frames
+  int budget_grid_parts; //fraction of the grid scanned on confident frames (1/parts)
+  int budget_nn;         //maximum number of fern detections sent to the NN classifier
+  int async_learning;    //1: run learning on a background thread
   ///Variables
 //Integral Images
   cv::Mat iisum;
@@ -101,6 +139,44 @@ private:
   std::vector<bool> dvalid;
   std::vector<float> dconf;
   bool detected;
+  //Deadline mode data
+  int frames_since_full;
+  int grid_phase;
+  bool learn_pending;
+  LearnJob pending_job;  //learning data of the deferred frame
+  FrameReport report;
+#ifdef TLD_METRICS
+  MetricsLog metrics;
+#endif
+  //Learning thread
+  //Ownership of the learning state (classifier, pX, pEx, good_boxes, bad_boxes, best_box, bbhull,
+  //generator and the overlaps of the grid boxes):
+  // - init() and loadModel() begin with stopLearner(), which joins the learner and drops its queued job:
+  //   the frame thread then owns the state and rebuilds it with the grid, scales and training sets.
+  // - both end with startLearner(), which publishes classifier.snapshot() and starts the learner: from
+  //   then on, until the next stopLearner(), only update() on the learner touches the state. The frame
+  //   thread passes it LearnJob copies and reads nothing but the grid geometry and the published
+  //   snapshots, which share the detector's data copy-on-write (see FerNNClassifier::snapshot).
+  // - without async_learning the frame thread keeps the state and reads classifier directly.
+  const FerNNClassifier* model;                        //model used by track/detect
+  std::shared_ptr<const FerNNClassifier> model_ref;    //keeps the frame's published model alive
+  std::shared_ptr<const FerNNClassifier> published;    //last model published by the learner
+  std::thread learner;
+  std::mutex model_mutex;  //held by the learner while it updates classifier, and by saveModel
+  std::mutex learn_mutex;
+  std::condition_variable learn_cv;
+  LearnJob learn_job;
+  bool job_ready;
+  bool learner_stop;
+  bool learn_failed;   //the last update of the learner found no good boxes
+  int jobs_dropped;     //learning jobs replaced before they ran (learning thread or deadline mode)
+  void learnerLoop();
+  void startLearner();
+  void stopLearner();
+  bool snapshotLearn(const cv::Mat& img,LearnJob& job,bool clone);
+  bool runLearn(LearnJob& job);
+  bool update(const LearnJob& job);
+  void allocate(const cv::Mat& frame1);
 
 
   //Bounding Boxes
@@ -115,21 +191,36 @@ public:
   //Constructors
   TLD();
   TLD(const cv::FileNode& file);
+  ~TLD();
   void read(const cv::FileNode& file);
   //Methods
+  //bb_file receives one line per frame (x1,y1,x2,y2,conf); may be NULL
   void init(const cv::Mat& frame1,const cv::Rect &box, FILE* bb_file);
+  bool saveModel(const char* path);
+  bool loadModel(const cv::Mat& frame1,const char* path,const cv::Rect& box,FILE* bb_file);
   void generatePositiveData(const cv::Mat& frame, int num_warps);
   void generateNegativeData(const cv::Mat& frame);
   void processFrame(const cv::Mat& img1,const cv::Mat& img2,std::vector<cv::Point2f>& points1,std::vector<cv::Point2f>& points2,
       BoundingBox& bbnext,bool& lastboxfound, bool tl,FILE* bb_file);
   void track(const cv::Mat& img1, const cv::Mat& img2,std::vector<cv::Point2f>& points1,std::vector<cv::Point2f>& points2);
-  void detect(const cv::Mat& frame);
+  void detect(const cv::Mat& frame,bool full=true);
   void clusterConf(const std::vector<BoundingBox>& dbb,const std::vector<float>& dconf,std::vector<BoundingBox>& cbb,std::vector<float>& cconf);
   void evaluate();
   void learn(const cv::Mat& img);
+  const FrameReport& getReport(){return report;}
+  //Whether the last box is valid (false after loadModel without a box)
+  bool isValid() const {return lastvalid;}
+  //Model used by the last frame (the learner's published snapshot with async_learning)
+  const FerNNClassifier& getModel() const {return *model;}
+  int getDroppedJobs(){return jobs_dropped;}
+#ifdef TLD_METRICS
+  MetricsLog& getMetrics(){return metrics;}
+  const MetricsLog& getMetrics() const {return metrics;}
+#endif
   //Tools
   void buildGrid(const cv::Mat& img, const cv::Rect& box);
-  float bbOverlap(const BoundingBox& box1,const BoundingBox& box2);
+  void addScale(const cv::Mat& img,const cv::Size& scale,int sidx,const cv::Rect& box);
+  static float bbOverlap(const BoundingBox& box1,const BoundingBox& box2);
   void getOverlappingBoxes(const cv::Rect& box1,int num_closest);
   void getBBHull();
   void getPattern(const cv::Mat& img, cv::Mat& pattern,cv::Scalar& mean,cv::Scalar& stdev);
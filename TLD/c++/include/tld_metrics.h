@@ -0,0 +1,85 @@
+/*
+ * tld_metrics.h
+ *
+ * Per-frame counters and stage timers of the TLD cascade.
+ * Recording is compiled in only when TLD_METRICS is defined (cmake -DTLD_METRICS=ON);
+ * otherwise the TLD_METRIC_* macros expand to nothing and TLD carries no log.
+ */
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <stdio.h>
+#include <vector>
+
+//Learning outcome of a frame
+enum LearnStatus {
+  LEARN_NONE = 0,         //learning not requested
+  LEARN_DONE,             //model updated
+  LEARN_QUEUED,           //snapshot handed to the learning thread
+  LEARN_DEFERRED,         //postponed by the deadline mode
+  LEARN_FAST_CHANGE,      //NN confidence of the box < 0.5
+  LEARN_LOW_VARIANCE,     //box variance below the variance filter
+  LEARN_IN_NEGATIVE,      //box matches a negative example
+  LEARN_NO_GOOD_BOXES     //no grid box overlaps the object
+};
+
+//One record per processed frame
+struct FrameMetrics {
+  int frame;
+  //counters
+  int tracked;            //LK tracker produced a valid box
+  int tracked_points;     //points surviving the forward-backward filter
+  int scanned_boxes;      //grid boxes visited by the detector
+  int var_passed;         //boxes that passed the variance filter
+  int fern_detections;    //boxes accepted by the fern ensemble
+  int nn_matches;         //boxes accepted by the NN classifier
+  int clusters;           //clusters of NN matches
+  int learn_status;       //LearnStatus
+  int pex;                //positive NN examples in the model
+  int nex;                //negative NN examples in the model
+  float nn_int8_err;      //largest int8 vs float NN confidence difference (nn_int8_check)
+  //timers (ms)
+  float track_ms;
+  float fern_ms;          //integral images, blur, variance filter and ferns
+  float nn_ms;            //NN classifier on the fern detections
+  float cluster_ms;
+  float learn_ms;         //time spent in learning on the frame thread
+  float total_ms;
+};
+
+//Ring buffer of the last frames, optionally streamed to a CSV file
+class MetricsLog{
+private:
+  std::vector<FrameMetrics> ring;
+  int head;               //slot of the current record
+  int count;
+  int frames;
+  FILE* csv;
+  void writeRecord(FILE* f,const FrameMetrics& m) const;
+public:
+  MetricsLog(int capacity=1024);
+  ~MetricsLog();
+  //Start a new record (flushes the previous one to the CSV sink)
+  void next();
+  FrameMetrics& current(){return ring[head];}
+  //Records currently in the ring, oldest first
+  int size() const {return count;}
+  const FrameMetrics& at(int i) const {return ring[(head-count+1+i+ring.size())%ring.size()];}
+  bool open(const char* path);
+  void close();
+  void writeCSV(FILE* f) const;
+  static void writeCSVHeader(FILE* f);
+};
+
+#ifdef TLD_METRICS
+#define TLD_METRIC_FRAME(log) (log).next()
+#define TLD_METRIC_SET(log,field,value) ((log).current().field = (value))
+#define TLD_METRIC_MAX(log,field,value) ((log).current().field = std::max((log).current().field,(value)))
+#define TLD_METRIC_TIC(name) const double name = (double)cv::getTickCount()
+#define TLD_METRIC_TOC(log,field,name) ((log).current().field = (float)(((double)cv::getTickCount()-name)*1000.0/cv::getTickFrequency()))
+#else
+#define TLD_METRIC_FRAME(log) ((void)0)
+#define TLD_METRIC_SET(log,field,value) ((void)0)
+#define TLD_METRIC_MAX(log,field,value) ((void)0)
+#define TLD_METRIC_TIC(name) ((void)0)
+#define TLD_METRIC_TOC(log,field,name) ((void)0)
+#endif
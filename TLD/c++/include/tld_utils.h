@@ -13,3 +13,24 @@ float median(std::vector<float> v);
 
 std::vector<int> index_shuffle(int begin,int end);
 
+//Read-only view of a whole file, memory-mapped where the platform allows it
+class MappedFile{
+private:
+  uchar* ptr;
+  size_t len;
+  bool mapped;
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+public:
+  MappedFile():ptr(NULL),len(0),mapped(false){}
+  ~MappedFile(){close();}
+  bool open(const char* path);
+  void close();
+  const uchar* data() const {return ptr;}
+  size_t size() const {return len;}
+};
+
+//Pads a binary file with zeros up to the next multiple of align bytes
+void writePadding(FILE* f,int align=16);
+inline size_t alignOffset(size_t offset,int align=16){return (offset+align-1)/align*align;}
+
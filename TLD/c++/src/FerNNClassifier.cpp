@@ -6,10 +6,61 @@
  */
 
 #include <FerNNClassifier.h>
+#include <string.h>
+#include <atomic>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace cv;
 using namespace std;
 
+FerNNClassifier::FerNNClassifier()
+:features(new FeatureSet),posteriors(new Posteriors),examples(new NNExamples){
+}
+
+//Copy-on-write: a block still held by a snapshot is copied before being written.
+//Only the owner makes snapshots, so a count of 1 cannot grow behind its back; the fence orders
+//our writes after the reads of the snapshot that released the block.
+template<class T> static T& unshare(std::shared_ptr<T>& block){
+  if (block.use_count()>1)
+    block = std::make_shared<T>(*block);
+  else
+    std::atomic_thread_fence(std::memory_order_acquire);
+  return *block;
+}
+
+FerNNClassifier::Posteriors& FerNNClassifier::mutablePosteriors(){
+  return unshare(posteriors);
+}
+
+FerNNClassifier::NNExamples& FerNNClassifier::mutableExamples(){
+  return unshare(examples);
+}
+
+shared_ptr<const FerNNClassifier> FerNNClassifier::snapshot() const {
+  FerNNClassifier* s = new FerNNClassifier;
+  s->thr_fern = thr_fern;
+  s->structSize = structSize;
+  s->nstructs = nstructs;
+  s->valid = valid;
+  s->ncc_thesame = ncc_thesame;
+  s->thr_nn = thr_nn;
+  s->acum = acum;
+  s->nn_int8 = nn_int8;
+  s->nn_int8_check = nn_int8_check;
+  s->storage = storage;
+  s->features = features;
+  s->posteriors = posteriors;
+  s->examples = examples;
+  s->thr_nn_valid = thr_nn_valid;
+  s->thrN = thrN;
+  s->thrP = thrP;
+  return shared_ptr<const FerNNClassifier>(s);
+}
+
 void FerNNClassifier::read(const FileNode& file){
   ///Classifier Parameters
   valid = (float)file["valid"];
@@ -19,13 +70,15 @@ void FerNNClassifier::read(const FileNode& file){
   thr_fern = (float)file["thr_fern"];
   thr_nn = (float)file["thr_nn"];
   thr_nn_valid = (float)file["thr_nn_valid"];
+  nn_int8 = (int)file["nn_int8"];
+  nn_int8_check = (int)file["nn_int8_check"];
 }
 
 void FerNNClassifier::prepare(const vector<Size>& scales){
   acum = 0;
   //Initialize test locations for features
   int totalFeatures = nstructs*structSize;
-  features = vector<vector<Feature> >(scales.size(),vector<Feature> (totalFeatures));
+  FeatureSet* fs = new FeatureSet(scales.size(),vector<Feature> (totalFeatures));
   RNG& rng = theRNG();
   float x1f,x2f,y1f,y2f;
   int x1, x2, y1, y2;
@@ -39,49 +92,51 @@ void FerNNClassifier::prepare(const vector<Size>& scales){
           y1 = y1f * scales[s].height;
           x2 = x2f * scales[s].width;
           y2 = y2f * scales[s].height;
-          features[s][i] = Feature(x1, y1, x2, y2);
+          (*fs)[s][i] = Feature(x1, y1, x2, y2);
       }
 
   }
+  features.reset(fs);
   //Thresholds
   thrN = 0.5*nstructs;
 
   //Initialize Posteriors
-  for (int i = 0; i<nstructs; i++) {
-      posteriors.push_back(vector<float>(pow(2.0,structSize), 0));
-      pCounter.push_back(vector<int>(pow(2.0,structSize), 0));
-      nCounter.push_back(vector<int>(pow(2.0,structSize), 0));
-  }
+  posteriors = make_shared<Posteriors>(nstructs,vector<float>(pow(2.0,structSize), 0));
+  pCounter.assign(nstructs,vector<int>(pow(2.0,structSize), 0));
+  nCounter.assign(nstructs,vector<int>(pow(2.0,structSize), 0));
 }
 
-void FerNNClassifier::getFeatures(const cv::Mat& image,const int& scale_idx, vector<int>& fern){
+void FerNNClassifier::getFeatures(const cv::Mat& image,const int& scale_idx, vector<int>& fern) const {
+  const vector<Feature>& scale_features = (*features)[scale_idx];
   int leaf;
   for (int t=0;t<nstructs;t++){
       leaf=0;
       for (int f=0; f<structSize; f++){
-          leaf = (leaf << 1) + features[scale_idx][t*nstructs+f](image);
+          leaf = (leaf << 1) + scale_features[t*nstructs+f](image);
       }
       fern[t]=leaf;
   }
 }
 
-float FerNNClassifier::measure_forest(vector<int> fern) {
+float FerNNClassifier::measure_forest(const vector<int>& fern) const {
+  const Posteriors& post = *posteriors;
   float votes = 0;
   for (int i = 0; i < nstructs; i++) {
-      votes += posteriors[i][fern[i]];
+      votes += post[i][fern[i]];
   }
   return votes;
 }
 
 void FerNNClassifier::update(const vector<int>& fern, int C, int N) {
+  Posteriors& post = mutablePosteriors();
   int idx;
   for (int i = 0; i < nstructs; i++) {
       idx = fern[i];
       (C==1) ? pCounter[i][idx] += N : nCounter[i][idx] += N;
       if (pCounter[i][idx]==0) {
-          posteriors[i][idx] = 0;
+          post[i][idx] = 0;
       } else {
-          posteriors[i][idx] = ((float)(pCounter[i][idx]))/(pCounter[i][idx] + nCounter[i][idx]);
+          post[i][idx] = ((float)(pCounter[i][idx]))/(pCounter[i][idx] + nCounter[i][idx]);
       }
   }
 }
@@ -120,47 +175,88 @@ void FerNNClassifier::trainNN(const vector<cv::Mat>& nn_examples){
       NNConf(nn_examples[i],isin,conf,dummy);                      //  Measure Relative similarity
       if (y[i]==1 && conf<=thr_nn){                                //    if y(i) == 1 && conf1 <= tld.model.thr_nn % 0.65
           if (isin[1]<0){                                          //      if isnan(isin(2))
-              pEx = vector<Mat>(1,nn_examples[i]);                 //        tld.pex = x(:,i);
+              NNExamples& ex = mutableExamples();
+              ex.pEx.clear();                                      //        tld.pex = x(:,i);
+              ex.pExQ.clear();
+              addExample(nn_examples[i],true);
               continue;                                            //        continue;
           }                                                        //      end
           //pEx.insert(pEx.begin()+isin[1],nn_examples[i]);        //      tld.pex = [tld.pex(:,1:isin(2)) x(:,i) tld.pex(:,isin(2)+1:end)]; % add to model
-          pEx.push_back(nn_examples[i]);
+          addExample(nn_examples[i],true);
       }                                                            //    end
       if(y[i]==0 && conf>0.5)                                      //  if y(i) == 0 && conf1 > 0.5
-        nEx.push_back(nn_examples[i]);                             //    tld.nex = [tld.nex x(:,i)];
+        addExample(nn_examples[i],false);                          //    tld.nex = [tld.nex x(:,i)];
 
   }                                                                 //  end
   acum++;
-  printf("%d. Trained NN examples: %d positive %d negative\n",acum,(int)pEx.size(),(int)nEx.size());
 }                                                                  //  end
 
 
-void FerNNClassifier::NNConf(const Mat& example, vector<int>& isin,float& rsconf,float& csconf){
+void FerNNClassifier::addExample(const Mat& example,bool positive){
+  NNExamples& ex = mutableExamples();
+  if (!nn_int8 || nn_int8_check)
+    (positive ? ex.pEx : ex.nEx).push_back(example);
+  if (nn_int8)
+    (positive ? ex.pExQ : ex.nExQ).push_back(example);
+}
+
+void FerNNClassifier::NNConf(const Mat& example, vector<int>& isin,float& rsconf,float& csconf) const {
+  NNConf(example,isin,rsconf,csconf,nn_int8!=0);
+}
+
+//Largest difference between the int8 and float confidences of a pattern (0 unless nn_int8_check)
+float FerNNClassifier::NNConfError(const Mat& example) const {
+  if (!nn_int8 || !nn_int8_check)
+    return 0;
+  vector<int> isin;
+  float rsq,csq,rsf,csf;
+  NNConf(example,isin,rsq,csq,true);
+  NNConf(example,isin,rsf,csf,false);
+  return max(fabs(rsq-rsf),fabs(csq-csf));
+}
+
+void FerNNClassifier::NNConf(const Mat& example, vector<int>& isin,float& rsconf,float& csconf,bool quantized) const {
   /*Inputs:
    * -NN Patch
    * Outputs:
    * -Relative Similarity (rsconf), Conservative Similarity (csconf), In pos. set|Id pos set|In neg. set (isin)
    */
+  const vector<Mat>& pEx = examples->pEx;
+  const vector<Mat>& nEx = examples->nEx;
+  const QuantizedPatterns& pExQ = examples->pExQ;
+  const QuantizedPatterns& nExQ = examples->nExQ;
   isin=vector<int>(3,-1);
-  if (pEx.empty()){ //if isempty(tld.pex) % IF positive examples in the model are not defined THEN everything is negative
+  int npos = quantized ? pExQ.size() : (int)pEx.size();
+  int nneg = quantized ? nExQ.size() : (int)nEx.size();
+  if (npos==0){ //if isempty(tld.pex) % IF positive examples in the model are not defined THEN everything is negative
       rsconf = 0; //    conf1 = zeros(1,size(x,2));
       csconf=0;
       return;
   }
-  if (nEx.empty()){ //if isempty(tld.nex) % IF negative examples in the model are not defined THEN everything is positive
+  if (nneg==0){ //if isempty(tld.nex) % IF negative examples in the model are not defined THEN everything is positive
       rsconf = 1;   //    conf1 = ones(1,size(x,2));
       csconf=1;
       return;
   }
   Mat ncc(1,1,CV_32F);
+  vector<schar> q;
+  float qscale, qnorm;
+  if (quantized){
+      q.resize(pExQ.stride);
+      quantizePattern(example,&q[0],pExQ.stride,qscale,qnorm);
+  }
   float nccP,csmaxP,maxP=0;
   bool anyP=false;
-  int maxPidx,validatedPart = ceil(pEx.size()*valid);
+  int maxPidx,validatedPart = ceil(npos*valid);
   float nccN, maxN=0;
   bool anyN=false;
-  for (int i=0;i<pEx.size();i++){
-      matchTemplate(pEx[i],example,ncc,CV_TM_CCORR_NORMED);      // measure NCC to positive examples
-      nccP=(((float*)ncc.data)[0]+1)*0.5;
+  for (int i=0;i<npos;i++){
+      if (quantized)
+        nccP=(pExQ.ncc(i,&q[0],qnorm)+1)*0.5;
+      else{
+        matchTemplate(pEx[i],example,ncc,CV_TM_CCORR_NORMED);      // measure NCC to positive examples
+        nccP=(((float*)ncc.data)[0]+1)*0.5;
+      }
       if (nccP>ncc_thesame)
         anyP=true;
       if(nccP > maxP){
@@ -170,9 +266,13 @@ void FerNNClassifier::NNConf(const Mat& example, vector<int>& isin,float& rsconf
             csmaxP=maxP;
       }
   }
-  for (int i=0;i<nEx.size();i++){
-      matchTemplate(nEx[i],example,ncc,CV_TM_CCORR_NORMED);     //measure NCC to negative examples
-      nccN=(((float*)ncc.data)[0]+1)*0.5;
+  for (int i=0;i<nneg;i++){
+      if (quantized)
+        nccN=(nExQ.ncc(i,&q[0],qnorm)+1)*0.5;
+      else{
+        matchTemplate(nEx[i],example,ncc,CV_TM_CCORR_NORMED);     //measure NCC to negative examples
+        nccN=(((float*)ncc.data)[0]+1)*0.5;
+      }
       if (nccN>ncc_thesame)
         anyN=true;
       if(nccN > maxN)
@@ -209,16 +309,299 @@ float fconf;
     thr_nn_valid = thr_nn;
 }
 
-void FerNNClassifier::show(){
-  Mat examples((int)pEx.size()*pEx[0].rows,pEx[0].cols,CV_8U);
+//Float NN examples (unpacked from the int8 sets when the float ones are not kept)
+void FerNNClassifier::floatExamples(vector<Mat>& pos,vector<Mat>& neg) const {
+  const NNExamples& ex = *examples;
+  if (!nn_int8 || nn_int8_check){
+      pos = ex.pEx;
+      neg = ex.nEx;
+      return;
+  }
+  pos.resize(ex.pExQ.size());
+  for (int i=0;i<ex.pExQ.size();i++)
+    pos[i] = ex.pExQ.unpack(i);
+  neg.resize(ex.nExQ.size());
+  for (int i=0;i<ex.nExQ.size();i++)
+    neg[i] = ex.nExQ.unpack(i);
+}
+
+void FerNNClassifier::show() const {
+  vector<Mat> pos, neg;
+  floatExamples(pos,neg);
+  Mat examples((int)pos.size()*pos[0].rows,pos[0].cols,CV_8U);
   double minval;
-  Mat ex(pEx[0].rows,pEx[0].cols,pEx[0].type());
-  for (int i=0;i<pEx.size();i++){
-    minMaxLoc(pEx[i],&minval);
-    pEx[i].copyTo(ex);
+  Mat ex(pos[0].rows,pos[0].cols,pos[0].type());
+  for (int i=0;i<pos.size();i++){
+    minMaxLoc(pos[i],&minval);
+    pos[i].copyTo(ex);
     ex = ex-minval;
-    Mat tmp = examples.rowRange(Range(i*pEx[i].rows,(i+1)*pEx[i].rows));
+    Mat tmp = examples.rowRange(Range(i*pos[i].rows,(i+1)*pos[i].rows));
     ex.convertTo(tmp,CV_8U);
   }
   imshow("Examples",examples);
 }
+
+//Binary model section, native byte order:
+//  parameters, then 16-byte aligned arrays: features, posteriors, pCounter, nCounter, pEx, nEx
+struct FernSectionHeader {
+  int nstructs;
+  int structSize;
+  int nscales;
+  int npex;
+  int nnex;
+  int patch_rows;
+  int patch_cols;
+  int acum;
+  float thr_fern;
+  float thr_nn;
+  float thr_nn_valid;
+  float valid;
+  float ncc_thesame;
+  float thrN;
+  float thrP;
+};
+
+static void writeExamples(FILE* f,const vector<Mat>& examples){
+  writePadding(f);
+  for (int i=0;i<examples.size();i++){
+      Mat ex = examples[i];
+      if (!ex.isContinuous())
+        ex = ex.clone();
+      fwrite(ex.data,sizeof(float),ex.rows*ex.cols,f);
+  }
+}
+
+bool FerNNClassifier::save(FILE* f) const {
+  //Snapshots have no counters
+  if (pCounter.size()!=(size_t)nstructs)
+    return false;
+  const FeatureSet& fs = *features;
+  const Posteriors& post = *posteriors;
+  vector<Mat> pos, neg;
+  floatExamples(pos,neg);
+  FernSectionHeader h;
+  h.nstructs = nstructs;
+  h.structSize = structSize;
+  h.nscales = (int)fs.size();
+  h.npex = (int)pos.size();
+  h.nnex = (int)neg.size();
+  h.patch_rows = pos.empty() ? 0 : pos[0].rows;
+  h.patch_cols = pos.empty() ? 0 : pos[0].cols;
+  h.acum = acum;
+  h.thr_fern = thr_fern;
+  h.thr_nn = thr_nn;
+  h.thr_nn_valid = thr_nn_valid;
+  h.valid = valid;
+  h.ncc_thesame = ncc_thesame;
+  h.thrN = thrN;
+  h.thrP = thrP;
+  fwrite(&h,sizeof(h),1,f);
+  writePadding(f);
+  for (int s=0;s<fs.size();s++)
+    fwrite(&fs[s][0],sizeof(Feature),fs[s].size(),f);
+  writePadding(f);
+  for (int i=0;i<nstructs;i++)
+    fwrite(&post[i][0],sizeof(float),post[i].size(),f);
+  writePadding(f);
+  for (int i=0;i<nstructs;i++)
+    fwrite(&pCounter[i][0],sizeof(int),pCounter[i].size(),f);
+  writePadding(f);
+  for (int i=0;i<nstructs;i++)
+    fwrite(&nCounter[i][0],sizeof(int),nCounter[i].size(),f);
+  writeExamples(f,pos);
+  writeExamples(f,neg);
+  return !ferror(f);
+}
+
+bool FerNNClassifier::load(const std::shared_ptr<MappedFile>& file,size_t& offset,int nscales,int patch_size){
+  const uchar* base = file->data();
+  size_t size = file->size();
+  if (offset+sizeof(FernSectionHeader)>size)
+    return false;
+  FernSectionHeader h;
+  memcpy(&h,base+offset,sizeof(h));
+  if (h.nstructs<=0 || h.structSize<=0 || h.structSize>24 || h.nscales<0 || h.npex<0 || h.nnex<0)
+    return false;
+  //The grid built by the caller indexes the scales and the NN compares patch_size patterns
+  if (h.nscales!=nscales)
+    return false;
+  if (h.npex+h.nnex>0 && (h.patch_rows!=patch_size || h.patch_cols!=patch_size))
+    return false;
+  int totalFeatures = h.nstructs*h.structSize;
+  int leaves = 1<<h.structSize;
+  int patch = h.patch_rows*h.patch_cols;
+  //Check the section fits before touching it
+  size_t end = alignOffset(offset+sizeof(h));
+  end = alignOffset(end+(size_t)h.nscales*totalFeatures*sizeof(Feature));
+  end = alignOffset(end+(size_t)h.nstructs*leaves*sizeof(float));
+  end = alignOffset(end+(size_t)h.nstructs*leaves*sizeof(int));
+  end = alignOffset(end+(size_t)h.nstructs*leaves*sizeof(int));
+  end = alignOffset(end+(size_t)h.npex*patch*sizeof(float));
+  end += (size_t)h.nnex*patch*sizeof(float);
+  if (end>size)
+    return false;
+  nstructs = h.nstructs;
+  structSize = h.structSize;
+  acum = h.acum;
+  thr_fern = h.thr_fern;
+  thr_nn = h.thr_nn;
+  thr_nn_valid = h.thr_nn_valid;
+  valid = h.valid;
+  ncc_thesame = h.ncc_thesame;
+  thrN = h.thrN;
+  thrP = h.thrP;
+  //Ferns: copied, they keep being updated
+  offset = alignOffset(offset+sizeof(h));
+  FeatureSet* fs = new FeatureSet(h.nscales,vector<Feature>(totalFeatures));
+  for (int s=0;s<h.nscales;s++){
+      memcpy(&(*fs)[s][0],base+offset,totalFeatures*sizeof(Feature));
+      offset += totalFeatures*sizeof(Feature);
+  }
+  features.reset(fs);
+  offset = alignOffset(offset);
+  posteriors = make_shared<Posteriors>(nstructs,vector<float>(leaves));
+  for (int i=0;i<nstructs;i++){
+      memcpy(&(*posteriors)[i][0],base+offset,leaves*sizeof(float));
+      offset += leaves*sizeof(float);
+  }
+  offset = alignOffset(offset);
+  pCounter = vector<vector<int> >(nstructs,vector<int>(leaves));
+  for (int i=0;i<nstructs;i++){
+      memcpy(&pCounter[i][0],base+offset,leaves*sizeof(int));
+      offset += leaves*sizeof(int);
+  }
+  offset = alignOffset(offset);
+  nCounter = vector<vector<int> >(nstructs,vector<int>(leaves));
+  for (int i=0;i<nstructs;i++){
+      memcpy(&nCounter[i][0],base+offset,leaves*sizeof(int));
+      offset += leaves*sizeof(int);
+  }
+  //NN examples: headers on the mapped file, never written (new examples are appended as new Mats)
+  examples = make_shared<NNExamples>();
+  vector<Mat>& pEx = examples->pEx;
+  vector<Mat>& nEx = examples->nEx;
+  offset = alignOffset(offset);
+  pEx.resize(h.npex);
+  for (int i=0;i<h.npex;i++){
+      pEx[i] = Mat(h.patch_rows,h.patch_cols,CV_32F,(void*)(base+offset));
+      offset += patch*sizeof(float);
+  }
+  offset = alignOffset(offset);
+  nEx.resize(h.nnex);
+  for (int i=0;i<h.nnex;i++){
+      nEx[i] = Mat(h.patch_rows,h.patch_cols,CV_32F,(void*)(base+offset));
+      offset += patch*sizeof(float);
+  }
+  storage = file;
+  if (nn_int8){
+      for (int i=0;i<pEx.size();i++)
+        examples->pExQ.push_back(pEx[i]);
+      for (int i=0;i<nEx.size();i++)
+        examples->nExQ.push_back(nEx[i]);
+      if (!nn_int8_check){
+          pEx.clear();
+          nEx.clear();
+      }
+  }
+  return true;
+}
+
+void quantizePattern(const Mat& pattern,schar* dst,int stride,float& scale,float& norm){
+  float maxabs = 0;
+  for (int r=0;r<pattern.rows;r++){
+      const float* p = pattern.ptr<float>(r);
+      for (int c=0;c<pattern.cols;c++)
+        maxabs = max(maxabs,(float)fabs(p[c]));
+  }
+  scale = maxabs>0 ? 127.f/maxabs : 0.f;
+  int k=0, sq=0;
+  for (int r=0;r<pattern.rows;r++){
+      const float* p = pattern.ptr<float>(r);
+      for (int c=0;c<pattern.cols;c++,k++){
+          int v = cvRound(p[c]*scale);
+          dst[k] = (schar)v;
+          sq += v*v;
+      }
+  }
+  for (;k<stride;k++)
+    dst[k] = 0;
+  norm = sqrt((float)sq);
+}
+
+//int8 x int8 products are widened to 16 bits and summed in pairs with (v)pmaddwd.
+//pmaddubsw is not used: with both operands signed it would need a bias and can saturate.
+int dotInt8(const schar* a,const schar* b,int stride){
+#if defined(__AVX2__)
+  __m256i acc = _mm256_setzero_si256();
+  for (int k=0;k<stride;k+=16){
+      __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(a+k)));
+      __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(b+k)));
+      acc = _mm256_add_epi32(acc,_mm256_madd_epi16(va,vb));
+  }
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc),_mm256_extracti128_si256(acc,1));
+  s = _mm_add_epi32(s,_mm_shuffle_epi32(s,_MM_SHUFFLE(1,0,3,2)));
+  s = _mm_add_epi32(s,_mm_shuffle_epi32(s,_MM_SHUFFLE(2,3,0,1)));
+  return _mm_cvtsi128_si32(s);
+#elif defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (int k=0;k<stride;k+=16){
+      __m128i va = _mm_loadu_si128((const __m128i*)(a+k));
+      __m128i vb = _mm_loadu_si128((const __m128i*)(b+k));
+      //sign extension: duplicate each byte into a 16-bit lane and shift it back down
+      __m128i alo = _mm_srai_epi16(_mm_unpacklo_epi8(va,va),8);
+      __m128i ahi = _mm_srai_epi16(_mm_unpackhi_epi8(va,va),8);
+      __m128i blo = _mm_srai_epi16(_mm_unpacklo_epi8(vb,vb),8);
+      __m128i bhi = _mm_srai_epi16(_mm_unpackhi_epi8(vb,vb),8);
+      acc = _mm_add_epi32(acc,_mm_madd_epi16(alo,blo));
+      acc = _mm_add_epi32(acc,_mm_madd_epi16(ahi,bhi));
+  }
+  acc = _mm_add_epi32(acc,_mm_shuffle_epi32(acc,_MM_SHUFFLE(1,0,3,2)));
+  acc = _mm_add_epi32(acc,_mm_shuffle_epi32(acc,_MM_SHUFFLE(2,3,0,1)));
+  return _mm_cvtsi128_si32(acc);
+#else
+  int sum = 0;
+  for (int k=0;k<stride;k++)
+    sum += a[k]*b[k];
+  return sum;
+#endif
+}
+
+void QuantizedPatterns::clear(){
+  data.clear();
+  norm.clear();
+  scale.clear();
+}
+
+void QuantizedPatterns::push_back(const Mat& pattern){
+  if (stride==0){
+      rows = pattern.rows;
+      cols = pattern.cols;
+      stride = (rows*cols+15)/16*16;
+  }
+  size_t n = norm.size();
+  data.resize((n+1)*stride);
+  float s, nrm;
+  quantizePattern(pattern,&data[n*stride],stride,s,nrm);
+  scale.push_back(s);
+  norm.push_back(nrm);
+}
+
+Mat QuantizedPatterns::unpack(int i) const {
+  Mat pattern(rows,cols,CV_32F);
+  const schar* q = row(i);
+  float inv = scale[i]>0 ? 1.f/scale[i] : 0.f;
+  for (int r=0;r<rows;r++){
+      float* p = pattern.ptr<float>(r);
+      for (int c=0;c<cols;c++)
+        p[c] = q[r*cols+c]*inv;
+  }
+  return pattern;
+}
+
+//Normalized cross-correlation of a quantized query with pattern i (cosine of the zero-mean patterns)
+float QuantizedPatterns::ncc(int i,const schar* q,float qnorm) const {
+  float d = qnorm*norm[i];
+  if (d<=0)
+    return 0;
+  return dotInt8(row(i),q,stride)/d;
+}
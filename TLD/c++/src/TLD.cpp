@@ -7,17 +7,41 @@
 
 #include <TLD.h>
 #include <stdio.h>
+#include <string.h>
 using namespace cv;
 using namespace std;
 
 
-TLD::TLD()
+TLD::TLD():model(&classifier),job_ready(false),learner_stop(false),learn_failed(false),jobs_dropped(0)
 {
 }
-TLD::TLD(const FileNode& file){
+TLD::TLD(const FileNode& file):model(&classifier),job_ready(false),learner_stop(false),learn_failed(false),jobs_dropped(0){
   read(file);
 }
 
+TLD::~TLD(){
+  stopLearner();
+}
+
+///Stop the learning thread (dropping a job it has not started) and go back to the local model
+void TLD::stopLearner(){
+  if (learner.joinable()){
+      {
+        lock_guard<mutex> lock(learn_mutex);
+        learner_stop = true;
+      }
+      learn_cv.notify_one();
+      learner.join();
+  }
+  learner_stop = false;
+  job_ready = false;
+  learn_failed = false;
+  learn_job = LearnJob();
+  published.reset();
+  model_ref.reset();
+  model = &classifier;
+}
+
 void TLD::read(const FileNode& file){
   ///Bounding Box Parameters
   min_win = (int)file["min_win"];
@@ -40,31 +64,29 @@ void TLD::read(const FileNode& file){
   //parameters for negative examples
   bad_overlap = (float)file["overlap"];
   bad_patches = (int)file["num_patches"];
+  //deadline mode (missing entries read as 0 and fall back to the full detector)
+  budget_mode = (int)file["budget_mode"];
+  budget_full_every = max((int)file["budget_full_every"],1);
+  budget_grid_parts = max((int)file["budget_grid_parts"],1);
+  budget_nn = (int)file["budget_nn"];
+  if (budget_nn<=0)
+    budget_nn = 100;
+  async_learning = (int)file["async_learning"];
   classifier.read(file);
 }
 
 void TLD::init(const Mat& frame1,const Rect& box,FILE* bb_file){
+  //Take the learning state back from the learner of a previous target before rebuilding it
+  stopLearner();
   //bb_file = fopen("bounding_boxes.txt","w");
   //Get Bounding Boxes
+    grid.clear();
+    scales.clear();
+    nX.clear();
     buildGrid(frame1,box);
     printf("Created %d bounding boxes\n",(int)grid.size());
   ///Preparation
-  //allocation
-  iisum.create(frame1.rows+1,frame1.cols+1,CV_32F);
-  iisqsum.create(frame1.rows+1,frame1.cols+1,CV_64F);
-  dconf.reserve(100);
-  dbb.reserve(100);
-  bbox_step =7;
-  //tmp.conf.reserve(grid.size());
-  tmp.conf = vector<float>(grid.size());
-  tmp.patt = vector<vector<int> >(grid.size(),vector<int>(10,0));
-  //tmp.patt.reserve(grid.size());
-  dt.bb.reserve(grid.size());
-  good_boxes.reserve(grid.size());
-  bad_boxes.reserve(grid.size());
-  pEx.create(patch_size,patch_size,CV_64F);
-  //Init Generator
-  generator = PatchGenerator (0,0,noise_init,true,1-scale_init,1+scale_init,-angle_init*CV_PI/180,angle_init*CV_PI/180,-angle_init*CV_PI/180,angle_init*CV_PI/180);
+  allocate(frame1);
   getOverlappingBoxes(box,num_closest_init);
   printf("Found %d good boxes, %d bad boxes\n",(int)good_boxes.size(),(int)bad_boxes.size());
   printf("Best Box: %d %d %d %d\n",best_box.x,best_box.y,best_box.width,best_box.height);
@@ -74,7 +96,8 @@ void TLD::init(const Mat& frame1,const Rect& box,FILE* bb_file){
   lastconf=1;
   lastvalid=true;
   //Print
-  fprintf(bb_file,"%d,%d,%d,%d,%f\n",lastbox.x,lastbox.y,lastbox.br().x,lastbox.br().y,lastconf);
+  if (bb_file)
+    fprintf(bb_file,"%d,%d,%d,%d,%f\n",lastbox.x,lastbox.y,lastbox.br().x,lastbox.br().y,lastconf);
   //Prepare Classifier
   classifier.prepare(scales);
   ///Generate Data
@@ -122,6 +145,140 @@ void TLD::init(const Mat& frame1,const Rect& box,FILE* bb_file){
   classifier.trainNN(nn_data);
   ///Threshold Evaluation on testing sets
   classifier.evaluateTh(nXT,nExT);
+  startLearner();
+}
+
+//Frame buffers and run-time state shared by init() and loadModel()
+void TLD::allocate(const Mat& frame1){
+  iisum.create(frame1.rows+1,frame1.cols+1,CV_32F);
+  iisqsum.create(frame1.rows+1,frame1.cols+1,CV_64F);
+  dconf.reserve(100);
+  dbb.reserve(100);
+  bbox_step =7;
+  //tmp.conf.reserve(grid.size());
+  tmp.conf = vector<float>(grid.size());
+  tmp.patt = vector<vector<int> >(grid.size(),vector<int>(10,0));
+  //tmp.patt.reserve(grid.size());
+  dt.bb.reserve(grid.size());
+  good_boxes.reserve(grid.size());
+  bad_boxes.reserve(grid.size());
+  pEx.create(patch_size,patch_size,CV_64F);
+  //Init Generator
+  generator = PatchGenerator (0,0,noise_init,true,1-scale_init,1+scale_init,-angle_init*CV_PI/180,angle_init*CV_PI/180,-angle_init*CV_PI/180,angle_init*CV_PI/180);
+  frames_since_full=0;
+  grid_phase=0;
+  learn_pending=false;
+  pending_job = LearnJob();
+}
+
+///Start the learning thread with the initial model published
+//Called last by init() and loadModel(): from here on the learner owns the learning state (see TLD.h)
+void TLD::startLearner(){
+  model = &classifier;
+  if (async_learning && !learner.joinable()){
+      published = classifier.snapshot();
+      learner = std::thread(&TLD::learnerLoop,this);
+  }
+}
+
+//Binary model file, native byte order:
+//  ModelHeader, nscales x (width,height), FerNNClassifier section
+struct ModelHeader {
+  char magic[4];  //"TLDM"
+  int version;
+  int patch_size;
+  int min_win;
+  float var;
+  int nscales;
+};
+static const int TLD_MODEL_VERSION = 1;
+
+bool TLD::saveModel(const char* path){
+  //With a learning thread running, wait for its current update (snapshots have no fern counters to save)
+  unique_lock<mutex> lock(model_mutex,defer_lock);
+  if (learner.joinable())
+    lock.lock();
+  FILE* f = fopen(path,"wb");
+  if (!f)
+    return false;
+  ModelHeader h;
+  memcpy(h.magic,"TLDM",4);
+  h.version = TLD_MODEL_VERSION;
+  h.patch_size = patch_size;
+  h.min_win = min_win;
+  h.var = var;
+  h.nscales = (int)scales.size();
+  fwrite(&h,sizeof(h),1,f);
+  for (int s=0;s<scales.size();s++){
+      int wh[2] = {scales[s].width,scales[s].height};
+      fwrite(wh,sizeof(int),2,f);
+  }
+  bool ok = classifier.save(f);
+  ok = fclose(f)==0 && ok;
+  return ok;
+}
+
+/* Warm start from a saved model
+ * The grid is rebuilt on frame1 from the stored scales (scales that do not fit the frame get no boxes)
+ * and the model is used as saved: no positive/negative data generation and no training.
+ * With a non-empty box tracking starts from the closest grid box, otherwise the detector has
+ * to find the object first.
+ */
+bool TLD::loadModel(const Mat& frame1,const char* path,const Rect& box,FILE* bb_file){
+  stopLearner();
+  std::shared_ptr<MappedFile> file(new MappedFile);
+  if (!file->open(path)){
+      printf("Could not read model %s\n",path);
+      return false;
+  }
+  ModelHeader h;
+  if (file->size()<sizeof(h)){
+      printf("Invalid model file %s\n",path);
+      return false;
+  }
+  memcpy(&h,file->data(),sizeof(h));
+  size_t offset = sizeof(h)+(size_t)max(h.nscales,0)*2*sizeof(int);
+  if (memcmp(h.magic,"TLDM",4)!=0 || h.nscales<=0 || h.patch_size<=0 || offset>file->size()){
+      printf("Invalid model file %s\n",path);
+      return false;
+  }
+  if (h.version!=TLD_MODEL_VERSION){
+      printf("Unsupported model version %d (expected %d)\n",h.version,TLD_MODEL_VERSION);
+      return false;
+  }
+  //The section must match the grid scales and NN patch of the header: both index into it
+  if (!classifier.load(file,offset,h.nscales,h.patch_size)){
+      printf("Invalid classifier section in %s\n",path);
+      return false;
+  }
+  patch_size = h.patch_size;
+  min_win = h.min_win;
+  var = h.var;
+  const int* wh = (const int*)(file->data()+sizeof(h));
+  scales.resize(h.nscales);
+  grid.clear();
+  for (int s=0;s<h.nscales;s++){
+      scales[s] = Size(wh[2*s],wh[2*s+1]);
+      addScale(frame1,scales[s],s,box);
+  }
+  printf("Loaded model: %d scales, %d boxes, %d positive and %d negative NN examples\n",
+         h.nscales,(int)grid.size(),classifier.numPositive(),classifier.numNegative());
+  allocate(frame1);
+  if (box.area()>0){
+      getOverlappingBoxes(box,num_closest_init);
+      lastbox=best_box;
+      lastconf=1;
+      lastvalid=true;
+      if (bb_file)
+        fprintf(bb_file,"%d,%d,%d,%d,%f\n",lastbox.x,lastbox.y,lastbox.br().x,lastbox.br().y,lastconf);
+  }
+  else{
+      lastvalid=false;
+      if (bb_file)
+        fprintf(bb_file,"NaN,NaN,NaN,NaN,NaN\n");
+  }
+  startLearner();
+  return true;
 }
 
 /* Generate Positive data
@@ -160,7 +317,6 @@ void TLD::generatePositiveData(const Mat& frame, int num_warps){
          pX.push_back(make_pair(fern,1));
      }
   }
-  printf("Positive examples generated: ferns:%d NN:1\n",(int)pX.size());
 }
 
 void TLD::getPattern(const Mat& img, Mat& pattern,Scalar& mean,Scalar& stdev){
@@ -229,24 +385,50 @@ void TLD::processFrame(const cv::Mat& img1,const cv::Mat& img2,vector<Point2f>&
   vector<float> cconf;
   int confident_detections=0;
   int didx; //detection index
+  TLD_METRIC_FRAME(metrics);
+  TLD_METRIC_TIC(t_frame);
+  report = FrameReport();
+  //Pick up the last published model; it stays fixed for the whole frame.
+  //An update the learner could not apply invalidates the box, as learn() does in the synchronous path
+  if (learner.joinable()){
+      bool failed;
+      {
+        lock_guard<mutex> lock(learn_mutex);
+        model_ref = published;
+        failed = learn_failed;
+        learn_failed = false;
+      }
+      model = model_ref.get();
+      if (failed)
+        lastvalid = false;
+  }
   ///Track
+  TLD_METRIC_TIC(t_track);
   if(lastboxfound && tl){
       track(img1,img2,points1,points2);
   }
   else{
       tracked = false;
   }
+  TLD_METRIC_TOC(metrics,track_ms,t_track);
+  TLD_METRIC_SET(metrics,tracked,tracked);
+  TLD_METRIC_SET(metrics,tracked_points,tracked ? (int)points2.size() : 0);
+  report.tracked = tracked;
   ///Detect
-  detect(img2);
+  //In deadline mode a confident tracker lets the detector scan a rotating part of the grid,
+  //but the full grid is still scanned at least every budget_full_every frames
+  bool full = true;
+  if (budget_mode && tracked && tconf>model->thr_nn_valid && frames_since_full+1<budget_full_every)
+    full = false;
+  detect(img2,full);
+  frames_since_full = full ? 0 : frames_since_full+1;
   ///Integration
   if (tracked){
       bbnext=tbb;
       lastconf=tconf;
       lastvalid=tvalid;
-      printf("Tracked\n");
       if(detected){                                               //   if Detected
           clusterConf(dbb,dconf,cbb,cconf);                       //   cluster detections
-          printf("Found %d clusters\n",(int)cbb.size());
           for (int i=0;i<cbb.size();i++){
               if (bbOverlap(tbb,cbb[i])<0.5 && cconf[i]>tconf){  //  Get index of a clusters that is far from tracker and are more confident than the tracker
                   confident_detections++;
@@ -254,13 +436,11 @@ void TLD::processFrame(const cv::Mat& img1,const cv::Mat& img2,vector<Point2f>&
               }
           }
           if (confident_detections==1){                                //if there is ONE such a cluster, re-initialize the tracker
-              printf("Found a better match..reinitializing tracking\n");
               bbnext=cbb[didx];
               lastconf=cconf[didx];
               lastvalid=false;
           }
           else {
-              printf("%d confident cluster was found\n",confident_detections);
               int cx=0,cy=0,cw=0,ch=0;
               int close_detections=0;
               for (int i=0;i<dbb.size();i++){
@@ -270,7 +450,6 @@ void TLD::processFrame(const cv::Mat& img1,const cv::Mat& img2,vector<Point2f>&
                       cw += dbb[i].width;
                       ch += dbb[i].height;
                       close_detections++;
-                      printf("weighted detection: %d %d %d %d\n",dbb[i].x,dbb[i].y,dbb[i].width,dbb[i].height);
                   }
               }
               if (close_detections>0){
@@ -278,39 +457,66 @@ void TLD::processFrame(const cv::Mat& img1,const cv::Mat& img2,vector<Point2f>&
                   bbnext.y = cvRound((float)(10*tbb.y+cy)/(float)(10+close_detections));
                   bbnext.width = cvRound((float)(10*tbb.width+cw)/(float)(10+close_detections));
                   bbnext.height =  cvRound((float)(10*tbb.height+ch)/(float)(10+close_detections));
-                  printf("Tracker bb: %d %d %d %d\n",tbb.x,tbb.y,tbb.width,tbb.height);
-                  printf("Average bb: %d %d %d %d\n",bbnext.x,bbnext.y,bbnext.width,bbnext.height);
-                  printf("Weighting %d close detection(s) with tracker..\n",close_detections);
-              }
-              else{
-                printf("%d close detections were found\n",close_detections);
-
               }
           }
       }
   }
   else{                                       //   If NOT tracking
-      printf("Not tracking..\n");
       lastboxfound = false;
       lastvalid = false;
       if(detected){                           //  and detector is defined
           clusterConf(dbb,dconf,cbb,cconf);   //  cluster detections
-          printf("Found %d clusters\n",(int)cbb.size());
           if (cconf.size()==1){
               bbnext=cbb[0];
               lastconf=cconf[0];
-              printf("Confident detection..reinitializing tracker\n");
               lastboxfound = true;
           }
       }
   }
   lastbox=bbnext;
-  if (lastboxfound)
-    fprintf(bb_file,"%d,%d,%d,%d,%f\n",lastbox.x,lastbox.y,lastbox.br().x,lastbox.br().y,lastconf);
-  else
-    fprintf(bb_file,"NaN,NaN,NaN,NaN,NaN\n");
-  if (lastvalid && tl)
-    learn(img2);
+  if (bb_file){
+      if (lastboxfound)
+        fprintf(bb_file,"%d,%d,%d,%d,%f\n",lastbox.x,lastbox.y,lastbox.br().x,lastbox.br().y,lastconf);
+      else
+        fprintf(bb_file,"NaN,NaN,NaN,NaN,NaN\n");
+  }
+  ///Learn
+  //In deadline mode the learning data of a full-detection frame is snapshotted and the update
+  //runs on the next partial-detection frame. At most one update is carried over: a full frame
+  //that finds one still pending drops it (the newer data replaces it) and learns inline,
+  //so no frame pays a carried-over update on top of a full scan.
+  TLD_METRIC_TIC(t_learn);
+  if (learn_pending){
+      if (!full){
+          //The update comes from the previous frame's data: its failure must not invalidate this box
+          report.deferred_failed = !runLearn(pending_job);
+          report.learned = true;
+      }
+      else{
+          jobs_dropped++;
+          report.deferred_dropped = true;
+      }
+      pending_job = LearnJob();
+      learn_pending = false;
+  }
+  if (lastvalid && tl){
+      if (budget_mode && full && !report.deferred_dropped){
+          if (snapshotLearn(img2,pending_job,true)){
+              learn_pending = true;
+              report.learning_deferred = true;
+              TLD_METRIC_SET(metrics,learn_status,LEARN_DEFERRED);
+          }
+      }
+      else{
+          learn(img2);
+          report.learned = true;
+      }
+  }
+  TLD_METRIC_TOC(metrics,learn_ms,t_learn);
+  TLD_METRIC_SET(metrics,scanned_boxes,report.scanned_boxes);
+  TLD_METRIC_SET(metrics,pex,model->numPositive());
+  TLD_METRIC_SET(metrics,nex,model->numNegative());
+  TLD_METRIC_TOC(metrics,total_ms,t_frame);
 }
 
 
@@ -323,7 +529,6 @@ void TLD::track(const Mat& img1, const Mat& img2,vector<Point2f>& points1,vector
   //Generate points
   bbPoints(points1,lastbox);
   if (points1.size()<1){
-      printf("BB= %d %d %d %d, Points not generated\n",lastbox.x,lastbox.y,lastbox.width,lastbox.height);
       tvalid=false;
       tracked=false;
       return;
@@ -337,7 +542,6 @@ void TLD::track(const Mat& img1, const Mat& img2,vector<Point2f>& points1,vector
       if (tracker.getFB()>10 || tbb.x>img2.cols ||  tbb.y>img2.rows || tbb.br().x < 1 || tbb.br().y <1){
           tvalid =false; //too unstable prediction or bounding box out of image
           tracked = false;
-          printf("Too unstable predictions FB error=%f\n",tracker.getFB());
           return;
       }
       //Estimate Confidence and Validity
@@ -351,15 +555,12 @@ void TLD::track(const Mat& img1, const Mat& img2,vector<Point2f>& points1,vector
       getPattern(img2(bb),pattern,mean,stdev);
       vector<int> isin;
       float dummy;
-      classifier.NNConf(pattern,isin,dummy,tconf); //Conservative Similarity
+      model->NNConf(pattern,isin,dummy,tconf); //Conservative Similarity
       tvalid = lastvalid;
-      if (tconf>classifier.thr_nn_valid){
+      if (tconf>model->thr_nn_valid){
           tvalid =true;
       }
   }
-  else
-    printf("No points tracked\n");
-
 }
 
 void TLD::bbPoints(vector<cv::Point2f>& points,const BoundingBox& bb){
@@ -380,7 +581,6 @@ void TLD::bbPredict(const vector<cv::Point2f>& points1,const vector<cv::Point2f>
   int npoints = (int)points1.size();
   vector<float> xoff(npoints);
   vector<float> yoff(npoints);
-  printf("tracked points : %d\n",npoints);
   for (int i=0;i<npoints;i++){
       xoff[i]=points2[i].x-points1[i].x;
       yoff[i]=points2[i].y-points1[i].y;
@@ -403,35 +603,45 @@ void TLD::bbPredict(const vector<cv::Point2f>& points1,const vector<cv::Point2f>
   }
   float s1 = 0.5*(s-1)*bb1.width;
   float s2 = 0.5*(s-1)*bb1.height;
-  printf("s= %f s1= %f s2= %f \n",s,s1,s2);
   bb2.x = round( bb1.x + dx -s1);
   bb2.y = round( bb1.y + dy -s2);
   bb2.width = round(bb1.width*s);
   bb2.height = round(bb1.height*s);
-  printf("predicted bb: %d %d %d %d\n",bb2.x,bb2.y,bb2.br().x,bb2.br().y);
 }
 
-void TLD::detect(const cv::Mat& frame){
+void TLD::detect(const cv::Mat& frame,bool full){
   //cleaning
   dbb.clear();
   dconf.clear();
   dt.bb.clear();
-  double t = (double)getTickCount();
+  TLD_METRIC_TIC(t_fern);
   Mat img(frame.rows,frame.cols,CV_8U);
   integral(frame,iisum,iisqsum);
   GaussianBlur(frame,img,Size(9,9),1.5);
-  int numtrees = classifier.getNumStructs();
-  float fern_th = classifier.getFernTh();
+  int numtrees = model->getNumStructs();
+  float fern_th = model->getFernTh();
   vector <int> ferns(10);
   float conf;
   int a=0;
   Mat patch;
-  for (int i=0;i<grid.size();i++){//FIXME: BottleNeck
+  //Partial scan: visit one of budget_grid_parts interleaved slices of the grid, rotating every call.
+  //Boxes outside the slice get no fern response this frame (no stale hard negatives for learning).
+  int start=0, step=1;
+  if (!full && budget_grid_parts>1){
+      step = budget_grid_parts;
+      start = grid_phase;
+      grid_phase = (grid_phase+1)%budget_grid_parts;
+      std::fill(tmp.conf.begin(),tmp.conf.end(),0.0f);
+  }
+  report.full_detection = (step==1);
+  report.scanned_boxes = ((int)grid.size()-start+step-1)/step;
+  report.skipped_boxes = (int)grid.size()-report.scanned_boxes;
+  for (int i=start;i<grid.size();i+=step){//FIXME: BottleNeck
       if (getVar(grid[i],iisum,iisqsum)>=var){
           a++;
 		  patch = img(grid[i]);
-          classifier.getFeatures(patch,grid[i].sidx,ferns);
-          conf = classifier.measure_forest(ferns);
+          model->getFeatures(patch,grid[i].sidx,ferns);
+          conf = model->measure_forest(ferns);
           tmp.conf[i]=conf;
           tmp.patt[i]=ferns;
           if (conf>numtrees*fern_th){
@@ -442,24 +652,26 @@ void TLD::detect(const cv::Mat& frame){
         tmp.conf[i]=0.0;
   }
   int detections = dt.bb.size();
-  printf("%d Bounding boxes passed the variance filter\n",a);
-  printf("%d Initial detection from Fern Classifier\n",detections);
-  if (detections>100){
-      nth_element(dt.bb.begin(),dt.bb.begin()+100,dt.bb.end(),CComparator(tmp.conf));
-      dt.bb.resize(100);
-      detections=100;
+  TLD_METRIC_SET(metrics,var_passed,a);
+  TLD_METRIC_SET(metrics,fern_detections,detections);
+  int max_nn = budget_mode ? budget_nn : 100;
+  if (detections>max_nn){
+      nth_element(dt.bb.begin(),dt.bb.begin()+max_nn,dt.bb.end(),CComparator(tmp.conf));
+      dt.bb.resize(max_nn);
+      report.nn_dropped = detections-max_nn;
+      detections=max_nn;
   }
+  report.nn_candidates = detections;
 //  for (int i=0;i<detections;i++){
 //        drawBox(img,grid[dt.bb[i]]);
 //    }
 //  imshow("detections",img);
+  TLD_METRIC_TOC(metrics,fern_ms,t_fern);
   if (detections==0){
         detected=false;
         return;
       }
-  printf("Fern detector made %d detections ",detections);
-  t=(double)getTickCount()-t;
-  printf("in %gms\n", t*1000/getTickFrequency());
+  TLD_METRIC_TIC(t_nn);
                                                                        //  Initialize detection structure
   dt.patt = vector<vector<int> >(detections,vector<int>(10,0));        //  Corresponding codes of the Ensemble Classifier
   dt.conf1 = vector<float>(detections);                                //  Relative Similarity (for final nearest neighbour classifier)
@@ -468,34 +680,39 @@ void TLD::detect(const cv::Mat& frame){
   dt.patch = vector<Mat>(detections,Mat(patch_size,patch_size,CV_32F));//  Corresponding patches
   int idx;
   Scalar mean, stdev;
-  float nn_th = classifier.getNNTh();
+  float nn_th = model->getNNTh();
   for (int i=0;i<detections;i++){                                         //  for every remaining detection
       idx=dt.bb[i];                                                       //  Get the detected bounding box index
 	  patch = frame(grid[idx]);
       getPattern(patch,dt.patch[i],mean,stdev);                //  Get pattern within bounding box
-      classifier.NNConf(dt.patch[i],dt.isin[i],dt.conf1[i],dt.conf2[i]);  //  Evaluate nearest neighbour classifier
+      model->NNConf(dt.patch[i],dt.isin[i],dt.conf1[i],dt.conf2[i]);      //  Evaluate nearest neighbour classifier
+      TLD_METRIC_MAX(metrics,nn_int8_err,model->NNConfError(dt.patch[i]));
       dt.patt[i]=tmp.patt[idx];
       //printf("Testing feature %d, conf:%f isin:(%d|%d|%d)\n",i,dt.conf1[i],dt.isin[i][0],dt.isin[i][1],dt.isin[i][2]);
       if (dt.conf1[i]>nn_th){                                               //  idx = dt.conf1 > tld.model.thr_nn; % get all indexes that made it through the nearest neighbour
-          dbb.push_back(grid[idx]);                                         //  BB    = dt.bb(:,idx); % bounding boxes
+          dbb.push_back(BoundingBox((Rect)grid[idx]));                      //  BB    = dt.bb(:,idx); % bounding boxes (geometry only, overlaps belong to the learner)
           dconf.push_back(dt.conf2[i]);                                     //  Conf  = dt.conf2(:,idx); % conservative confidences
       }
   }                                                                         //  end
-  if (dbb.size()>0){
-      printf("Found %d NN matches\n",(int)dbb.size());
-      detected=true;
-  }
-  else{
-      printf("No NN matches found.\n");
-      detected=false;
-  }
+  TLD_METRIC_TOC(metrics,nn_ms,t_nn);
+  TLD_METRIC_SET(metrics,nn_matches,(int)dbb.size());
+  detected = dbb.size()>0;
 }
 
 void TLD::evaluate(){
 }
 
 void TLD::learn(const Mat& img){
-  printf("[Learning] ");
+  LearnJob job;
+  if (snapshotLearn(img,job,learner.joinable()) && !runLearn(job))
+    lastvalid = false;
+}
+
+/* Consistency checks of lastbox on img and snapshot of the frame data the update needs
+ * (clone: copy the frame, the caller reuses its frame buffers).
+ * Returns false, with lastvalid cleared, when the box must not be learned.
+ */
+bool TLD::snapshotLearn(const Mat& img,LearnJob& job,bool clone){
   ///Check consistency
   BoundingBox bb;
   bb.x = max(lastbox.x,0);
@@ -507,68 +724,137 @@ void TLD::learn(const Mat& img){
   getPattern(img(bb),pattern,mean,stdev);
   vector<int> isin;
   float dummy, conf;
-  classifier.NNConf(pattern,isin,conf,dummy);
+  model->NNConf(pattern,isin,conf,dummy);
   if (conf<0.5) {
-      printf("Fast change..not training\n");
+      TLD_METRIC_SET(metrics,learn_status,LEARN_FAST_CHANGE);
       lastvalid =false;
-      return;
+      return false;
   }
   if (pow(stdev.val[0],2)<var){
-      printf("Low variance..not training\n");
+      TLD_METRIC_SET(metrics,learn_status,LEARN_LOW_VARIANCE);
       lastvalid=false;
-      return;
+      return false;
   }
   if(isin[2]==1){
-      printf("Patch in negative data..not traing");
+      TLD_METRIC_SET(metrics,learn_status,LEARN_IN_NEGATIVE);
       lastvalid=false;
-      return;
+      return false;
   }
+/// Frame data snapshot
+  job.img = clone ? img.clone() : img;
+  job.box = lastbox;
+  job.hard_idx.clear();
+  job.hard_patt.clear();
+  for (int i=0;i<grid.size();i++){
+      if (tmp.conf[i]>=1){
+          job.hard_idx.push_back(i);
+          job.hard_patt.push_back(tmp.patt[i]);
+      }
+  }
+  job.det_idx = dt.bb;
+  job.det_patch.assign(dt.patch.begin(),dt.patch.begin()+min(dt.patch.size(),dt.bb.size()));
+  return true;
+}
+
+//Model update from a snapshot: handed to the learning thread, or run here.
+//Returns false when the update found no good boxes; the caller decides what that invalidates.
+bool TLD::runLearn(LearnJob& job){
+  if (learner.joinable()){
+      //Hand the snapshot to the learning thread, replacing a job it has not started yet
+      {
+        lock_guard<mutex> lock(learn_mutex);
+        if (job_ready)
+          jobs_dropped++;
+        std::swap(learn_job,job);
+        job_ready = true;
+      }
+      learn_cv.notify_one();
+      TLD_METRIC_SET(metrics,learn_status,LEARN_QUEUED);
+      return true;
+  }
+  if (!update(job)){
+      TLD_METRIC_SET(metrics,learn_status,LEARN_NO_GOOD_BOXES);
+      return false;
+  }
+  TLD_METRIC_SET(metrics,learn_status,LEARN_DONE);
+  return true;
+}
+
+/* Update the model from a frame snapshot (P-N constraints, positive data, ferns and NN training)
+ * Runs on the frame thread, or on the learning thread when async_learning is set.
+ */
+bool TLD::update(const LearnJob& job){
 /// Data generation
   for (int i=0;i<grid.size();i++){
-      grid[i].overlap = bbOverlap(lastbox,grid[i]);
+      grid[i].overlap = bbOverlap(job.box,grid[i]);
   }
   vector<pair<vector<int>,int> > fern_examples;
   good_boxes.clear();
   bad_boxes.clear();
-  getOverlappingBoxes(lastbox,num_closest_update);
+  getOverlappingBoxes(job.box,num_closest_update);
   if (good_boxes.size()>0)
-    generatePositiveData(img,num_warps_update);
-  else{
-    lastvalid = false;
-    printf("No good boxes..Not training");
-    return;
-  }
-  fern_examples.reserve(pX.size()+bad_boxes.size());
+    generatePositiveData(job.img,num_warps_update);
+  else
+    return false;
+  fern_examples.reserve(pX.size()+job.hard_idx.size());
   fern_examples.assign(pX.begin(),pX.end());
   int idx;
-  for (int i=0;i<bad_boxes.size();i++){
-      idx=bad_boxes[i];
-      if (tmp.conf[idx]>=1){
-          fern_examples.push_back(make_pair(tmp.patt[idx],0));
+  for (int i=0;i<job.hard_idx.size();i++){
+      idx=job.hard_idx[i];
+      if (grid[idx].overlap < bad_overlap){
+          fern_examples.push_back(make_pair(job.hard_patt[i],0));
       }
   }
   vector<Mat> nn_examples;
-  nn_examples.reserve(dt.bb.size()+1);
+  nn_examples.reserve(job.det_patch.size()+1);
   nn_examples.push_back(pEx);
-  for (int i=0;i<dt.bb.size();i++){
-      idx = dt.bb[i];
-      if (bbOverlap(lastbox,grid[idx]) < bad_overlap)
-        nn_examples.push_back(dt.patch[i]);
+  for (int i=0;i<job.det_patch.size();i++){
+      idx = job.det_idx[i];
+      if (bbOverlap(job.box,grid[idx]) < bad_overlap)
+        nn_examples.push_back(job.det_patch[i]);
   }
   /// Classifiers update
   classifier.trainF(fern_examples,2);
   classifier.trainNN(nn_examples);
-  classifier.show();
+  return true;
+}
+
+void TLD::learnerLoop(){
+  LearnJob job;
+  for (;;){
+      {
+        unique_lock<mutex> lock(learn_mutex);
+        while (!job_ready && !learner_stop)
+          learn_cv.wait(lock);
+        if (learner_stop)
+          return;
+        std::swap(job,learn_job);
+        job_ready = false;
+      }
+      bool updated;
+      std::shared_ptr<const FerNNClassifier> snapshot;
+      {
+        lock_guard<mutex> lock(model_mutex);
+        updated = update(job);
+        //Frames still holding the previous snapshot keep using it: training copies the blocks they share
+        if (updated)
+          snapshot = classifier.snapshot();
+      }
+      if (!updated){
+          lock_guard<mutex> lock(learn_mutex);
+          learn_failed = true;
+          continue;
+      }
+      lock_guard<mutex> lock(learn_mutex);
+      published = snapshot;
+  }
 }
 
 void TLD::buildGrid(const cv::Mat& img, const cv::Rect& box){
-  const float SHIFT = 0.1;
   const float SCALES[] = {0.16151,0.19381,0.23257,0.27908,0.33490,0.40188,0.48225,
                           0.57870,0.69444,0.83333,1,1.20000,1.44000,1.72800,
                           2.07360,2.48832,2.98598,3.58318,4.29982,5.15978,6.19174};
   int width, height, min_bb_side;
-  //Rect bbox;
-  BoundingBox bbox;
   Size scale;
   int sc=0;
   for (int s=0;s<21;s++){
@@ -580,21 +866,29 @@ void TLD::buildGrid(const cv::Mat& img, const cv::Rect& box){
     scale.width = width;
     scale.height = height;
     scales.push_back(scale);
-    for (int y=1;y<img.rows-height;y+=round(SHIFT*min_bb_side)){
-      for (int x=1;x<img.cols-width;x+=round(SHIFT*min_bb_side)){
-        bbox.x = x;
-        bbox.y = y;
-        bbox.width = width;
-        bbox.height = height;
-        bbox.overlap = bbOverlap(bbox,BoundingBox(box));
-        bbox.sidx = sc;
-        grid.push_back(bbox);
-      }
-    }
+    addScale(img,scale,sc,box);
     sc++;
   }
 }
 
+//Adds the boxes of one scale to the grid
+void TLD::addScale(const cv::Mat& img,const cv::Size& scale,int sidx,const cv::Rect& box){
+  const float SHIFT = 0.1;
+  int min_bb_side = min(scale.height,scale.width);
+  BoundingBox bbox;
+  for (int y=1;y<img.rows-scale.height;y+=round(SHIFT*min_bb_side)){
+    for (int x=1;x<img.cols-scale.width;x+=round(SHIFT*min_bb_side)){
+      bbox.x = x;
+      bbox.y = y;
+      bbox.width = scale.width;
+      bbox.height = scale.height;
+      bbox.overlap = bbOverlap(bbox,BoundingBox(box));
+      bbox.sidx = sidx;
+      grid.push_back(bbox);
+    }
+  }
+}
+
 float TLD::bbOverlap(const BoundingBox& box1,const BoundingBox& box2){
   if (box1.x > box2.x+box2.width) { return 0.0; }
   if (box1.y > box2.y+box2.height) { return 0.0; }
@@ -650,8 +944,7 @@ void TLD::getBBHull(){
 }
 
 bool bbcomp(const BoundingBox& b1,const BoundingBox& b2){
-  TLD t;
-    if (t.bbOverlap(b1,b2)<0.5)
+    if (TLD::bbOverlap(b1,b2)<0.5)
       return false;
     else
       return true;
@@ -722,6 +1015,7 @@ int TLD::clusterBB(const vector<BoundingBox>& dbb,vector<int>& indexes){
 }
 
 void TLD::clusterConf(const vector<BoundingBox>& dbb,const vector<float>& dconf,vector<BoundingBox>& cbb,vector<float>& cconf){
+  TLD_METRIC_TIC(t_cluster);
   int numbb =dbb.size();
   vector<int> T;
   float space_thr = 0.5;
@@ -730,6 +1024,8 @@ void TLD::clusterConf(const vector<BoundingBox>& dbb,const vector<float>& dconf,
   case 1:
     cbb=vector<BoundingBox>(1,dbb[0]);
     cconf=vector<float>(1,dconf[0]);
+    TLD_METRIC_SET(metrics,clusters,1);
+    TLD_METRIC_TOC(metrics,cluster_ms,t_cluster);
     return;
     break;
   case 2:
@@ -747,14 +1043,12 @@ void TLD::clusterConf(const vector<BoundingBox>& dbb,const vector<float>& dconf,
   }
   cconf=vector<float>(c);
   cbb=vector<BoundingBox>(c);
-  printf("Cluster indexes: ");
   BoundingBox bx;
   for (int i=0;i<c;i++){
       float cnf=0;
       int N=0,mx=0,my=0,mw=0,mh=0;
       for (int j=0;j<T.size();j++){
           if (T[j]==i){
-              printf("%d ",i);
               cnf=cnf+dconf[j];
               mx=mx+dbb[j].x;
               my=my+dbb[j].y;
@@ -772,6 +1066,7 @@ void TLD::clusterConf(const vector<BoundingBox>& dbb,const vector<float>& dconf,
           cbb[i]=bx;
       }
   }
-  printf("\n");
+  TLD_METRIC_SET(metrics,clusters,c);
+  TLD_METRIC_TOC(metrics,cluster_ms,t_cluster);
 }
 
@@ -14,6 +14,9 @@ bool tl = true;
 bool rep = false;
 bool fromfile=false;
 string video;
+char* metrics_file = NULL;
+char* model_file = NULL;
+char* save_file = NULL;
 
 void readBB(char* file){
   ifstream bb_file (file);
@@ -62,6 +65,8 @@ void mouseHandler(int event, int x, int y, int flags, void *param){
 void print_help(char** argv){
   printf("use:\n     %s -p /path/parameters.yml\n",argv[0]);
   printf("-s    source video\n-b        bounding box file\n-tl  track and learn\n-r     repeat\n");
+  printf("-metrics    per-frame metrics CSV (needs a TLD_METRICS build)\n");
+  printf("-m    warm start from a saved model (-b optional)\n-save    save the model on exit (and on 's')\n");
 }
 
 void read_options(int argc, char** argv,VideoCapture& capture,FileStorage &fs){
@@ -97,6 +102,27 @@ void read_options(int argc, char** argv,VideoCapture& capture,FileStorage &fs){
       if (strcmp(argv[i],"-r")==0){
           rep = true;
       }
+      if (strcmp(argv[i],"-metrics")==0){
+          if (argc>i){
+              metrics_file = argv[i+1];
+          }
+          else
+            print_help(argv);
+      }
+      if (strcmp(argv[i],"-m")==0){
+          if (argc>i){
+              model_file = argv[i+1];
+          }
+          else
+            print_help(argv);
+      }
+      if (strcmp(argv[i],"-save")==0){
+          if (argc>i){
+              save_file = argv[i+1];
+          }
+          else
+            print_help(argv);
+      }
   }
 }
 
@@ -133,7 +159,7 @@ int main(int argc, char * argv[]){
 
   ///Initialization
 GETBOUNDINGBOX:
-  while(!gotBB)
+  while(!gotBB && !model_file)
   {
     if (!fromfile){
       capture >> frame;
@@ -146,25 +172,43 @@ GETBOUNDINGBOX:
     if (cvWaitKey(33) == 'q')
 	    return 0;
   }
-  if (min(box.width,box.height)<(int)fs.getFirstTopLevelNode()["min_win"]){
+  if (!model_file && min(box.width,box.height)<(int)fs.getFirstTopLevelNode()["min_win"]){
       cout << "Bounding box too small, try again." << endl;
       gotBB = false;
       goto GETBOUNDINGBOX;
   }
   //Remove callback
   cvSetMouseCallback( "TLD", NULL, NULL );
-  printf("Initial Bounding Box = x:%d y:%d h:%d w:%d\n",box.x,box.y,box.width,box.height);
+  if (gotBB)
+    printf("Initial Bounding Box = x:%d y:%d h:%d w:%d\n",box.x,box.y,box.width,box.height);
+  else if (!fromfile){
+      //Warm start without a box: the detector has to find the object
+      capture >> frame;
+      cvtColor(frame, last_gray, CV_RGB2GRAY);
+  }
   //Output file
   FILE  *bb_file = fopen("bounding_boxes.txt","w");
+  if (metrics_file){
+#ifdef TLD_METRICS
+      tld.getMetrics().open(metrics_file);
+#else
+      printf("Built without TLD_METRICS: %s will not be written\n",metrics_file);
+#endif
+  }
   //TLD initialization
-  tld.init(last_gray,box,bb_file);
+  if (model_file){
+      if (!tld.loadModel(last_gray,model_file,gotBB ? box : Rect(),bb_file))
+        return 1;
+  }
+  else
+    tld.init(last_gray,box,bb_file);
 
   ///Run-time
   Mat current_gray;
   BoundingBox pbox;
   vector<Point2f> pts1;
   vector<Point2f> pts2;
-  bool status=true;
+  bool status=gotBB;
   int frames = 1;
   int detections = 1;
 REPEAT:
@@ -173,6 +217,8 @@ REPEAT:
     cvtColor(frame, current_gray, CV_RGB2GRAY);
     //Process Frame
     tld.processFrame(last_gray,current_gray,pts1,pts2,pbox,status,tl,bb_file);
+    if (tld.getReport().learned)
+      tld.getModel().show();
     //Draw Points
     if (status){
       drawPoints(frame,pts1);
@@ -187,9 +233,11 @@ REPEAT:
     pts1.clear();
     pts2.clear();
     frames++;
-    printf("Detection rate: %d/%d\n",detections,frames);
-    if (cvWaitKey(33) == 'q')
+    int key = cvWaitKey(33);
+    if (key == 'q')
       break;
+    if (key == 's' && save_file && tld.saveModel(save_file))
+      printf("Model saved to %s\n",save_file);
   }
   if (rep){
     rep = false;
@@ -202,5 +250,15 @@ REPEAT:
     goto REPEAT;
   }
   fclose(bb_file);
+#ifdef TLD_METRICS
+  tld.getMetrics().close();
+#endif
+  if (save_file){
+      if (tld.saveModel(save_file))
+        printf("Model saved to %s\n",save_file);
+      else
+        printf("Could not save the model to %s\n",save_file);
+  }
+  printf("Detection rate: %d/%d\n",detections,frames);
   return 0;
 }
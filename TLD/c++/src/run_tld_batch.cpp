@@ -0,0 +1,254 @@
+/*
+ * run_tld_batch.cpp
+ *
+ * Headless TLD runner: no window, no mouse, no frame rate cap.
+ * Frames are decoded and converted to gray on a separate thread into a bounded queue.
+ */
+#include <opencv2/opencv.hpp>
+#include <tld_utils.h>
+#include <iostream>
+#include <sstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <TLD.h>
+#include <stdio.h>
+using namespace cv;
+using namespace std;
+//Options
+Rect box;
+bool gotBB = false;
+bool tl = true;
+char* source = NULL;
+char* params = NULL;
+char* model_file = NULL;
+char* metrics_file = NULL;
+const char* boxes_file = "bounding_boxes.txt";
+const char* timing_file = "timing.csv";
+int queue_size = 8;
+
+//Decodes frames and converts them to gray ahead of the tracker
+class FramePrefetcher{
+private:
+  VideoCapture& capture;
+  std::deque<Mat> queue;
+  size_t capacity;
+  bool done;
+  bool stop;
+  std::mutex mtx;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::thread worker;
+  void run(){
+    Mat frame;
+    while (capture.read(frame)){
+        Mat gray;
+        if (frame.channels()==1)
+          gray = frame.clone();
+        else
+          cvtColor(frame,gray,CV_RGB2GRAY);
+        unique_lock<mutex> lock(mtx);
+        while (queue.size()>=capacity && !stop)
+          not_full.wait(lock);
+        if (stop)
+          break;
+        queue.push_back(gray);
+        not_empty.notify_one();
+    }
+    lock_guard<mutex> lock(mtx);
+    done = true;
+    not_empty.notify_one();
+  }
+public:
+  FramePrefetcher(VideoCapture& cap,int size):capture(cap),capacity(max(size,1)),done(false),stop(false){
+    worker = std::thread(&FramePrefetcher::run,this);
+  }
+  ~FramePrefetcher(){
+    {
+      lock_guard<mutex> lock(mtx);
+      stop = true;
+    }
+    not_full.notify_one();
+    worker.join();
+  }
+  //Next gray frame; false at the end of the stream
+  bool pop(Mat& gray){
+    unique_lock<mutex> lock(mtx);
+    while (queue.empty() && !done)
+      not_empty.wait(lock);
+    if (queue.empty())
+      return false;
+    gray = queue.front();
+    queue.pop_front();
+    not_full.notify_one();
+    return true;
+  }
+};
+
+void readBB(char* file){
+  ifstream bb_file (file);
+  string line;
+  getline(bb_file,line);
+  istringstream linestream(line);
+  string x1,y1,x2,y2;
+  getline (linestream,x1, ',');
+  getline (linestream,y1, ',');
+  getline (linestream,x2, ',');
+  getline (linestream,y2, ',');
+  int x = atoi(x1.c_str());
+  int y = atoi(y1.c_str());
+  int w = atoi(x2.c_str())-x;
+  int h = atoi(y2.c_str())-y;
+  box = Rect(x,y,w,h);
+}
+
+void print_help(char** argv){
+  printf("use:\n     %s -p /path/parameters.yml -s source\n",argv[0]);
+  printf("-s    source video or image sequence (e.g. img%%05d.png)\n");
+  printf("-b    bounding box file (default: bb_x, bb_y, bb_w, bb_h from the parameters file)\n");
+  printf("-o    bounding boxes output (default bounding_boxes.txt)\n");
+  printf("-t    per-frame timing output (default timing.csv)\n");
+  printf("-q    decoded frames queue size (default 8)\n");
+  printf("-m    warm start from a saved model\n");
+  printf("-metrics    per-frame metrics CSV (needs a TLD_METRICS build)\n");
+  printf("-no_tl    no tracking, no learning\n");
+}
+
+bool read_options(int argc, char** argv){
+  for (int i=1;i<argc;i++){
+      bool has_value = i+1<argc;
+      if (strcmp(argv[i],"-no_tl")==0){
+          tl = false;
+          continue;
+      }
+      if (!has_value){
+          print_help(argv);
+          return false;
+      }
+      if (strcmp(argv[i],"-b")==0){
+          readBB(argv[++i]);
+          gotBB = true;
+      }
+      else if (strcmp(argv[i],"-s")==0)
+        source = argv[++i];
+      else if (strcmp(argv[i],"-p")==0)
+        params = argv[++i];
+      else if (strcmp(argv[i],"-o")==0)
+        boxes_file = argv[++i];
+      else if (strcmp(argv[i],"-t")==0)
+        timing_file = argv[++i];
+      else if (strcmp(argv[i],"-q")==0)
+        queue_size = atoi(argv[++i]);
+      else if (strcmp(argv[i],"-m")==0)
+        model_file = argv[++i];
+      else if (strcmp(argv[i],"-metrics")==0)
+        metrics_file = argv[++i];
+  }
+  if (!source || !params){
+      print_help(argv);
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char * argv[]){
+  if (!read_options(argc,argv))
+    return 1;
+  FileStorage fs;
+  if (!fs.open(params,FileStorage::READ)){
+      printf("Could not open %s\n",params);
+      return 1;
+  }
+  FileNode file = fs.getFirstTopLevelNode();
+  if (!gotBB && !model_file){
+      box = Rect((int)file["bb_x"],(int)file["bb_y"],(int)file["bb_w"],(int)file["bb_h"]);
+      gotBB = box.area()>0;
+  }
+  if (!gotBB && !model_file){
+      printf("No initial bounding box (-b or bb_x/bb_y/bb_w/bb_h)\n");
+      return 1;
+  }
+  if (gotBB && !model_file && min(box.width,box.height)<(int)file["min_win"]){
+      printf("Bounding box too small\n");
+      return 1;
+  }
+  VideoCapture capture;
+  if (!capture.open(string(source))){
+      printf("Could not open %s\n",source);
+      return 1;
+  }
+  FramePrefetcher frames(capture,queue_size);
+  //TLD framework
+  TLD tld;
+  tld.read(file);
+  Mat last_gray;
+  if (!frames.pop(last_gray)){
+      printf("Empty source %s\n",source);
+      return 1;
+  }
+  FILE* bb_file = fopen(boxes_file,"w");
+  FILE* t_file = fopen(timing_file,"w");
+  if (!bb_file || !t_file){
+      printf("Could not open the output files\n");
+      return 1;
+  }
+  if (metrics_file){
+#ifdef TLD_METRICS
+      tld.getMetrics().open(metrics_file);
+#else
+      printf("Built without TLD_METRICS: %s will not be written\n",metrics_file);
+#endif
+  }
+  fprintf(t_file,"frame,found,x,y,w,h,ms\n");
+  //TLD initialization
+  double t = (double)getTickCount();
+  if (model_file){
+      if (!tld.loadModel(last_gray,model_file,gotBB ? box : Rect(),bb_file))
+        return 1;
+  }
+  else
+    tld.init(last_gray,box,bb_file);
+  t = ((double)getTickCount()-t)*1000/getTickFrequency();
+  //NaN box when the initial one was not accepted, as tldExample writes it
+  bool valid = gotBB && tld.isValid();
+  if (valid)
+    fprintf(t_file,"0,1,%d,%d,%d,%d,%.3f\n",box.x,box.y,box.width,box.height,t);
+  else
+    fprintf(t_file,"0,0,NaN,NaN,NaN,NaN,%.3f\n",t);
+
+  ///Run-time
+  Mat current_gray;
+  BoundingBox pbox;
+  vector<Point2f> pts1;
+  vector<Point2f> pts2;
+  bool status=valid;
+  int nframes = 1;
+  int detections = valid ? 1 : 0;
+  double total = 0;
+  while(frames.pop(current_gray)){
+    t = (double)getTickCount();
+    tld.processFrame(last_gray,current_gray,pts1,pts2,pbox,status,tl,bb_file);
+    t = ((double)getTickCount()-t)*1000/getTickFrequency();
+    total += t;
+    if (status){
+        fprintf(t_file,"%d,1,%d,%d,%d,%d,%.3f\n",nframes,pbox.x,pbox.y,pbox.width,pbox.height,t);
+        detections++;
+    }
+    else
+      fprintf(t_file,"%d,0,NaN,NaN,NaN,NaN,%.3f\n",nframes,t);
+    swap(last_gray,current_gray);
+    pts1.clear();
+    pts2.clear();
+    nframes++;
+  }
+  fclose(bb_file);
+  fclose(t_file);
+#ifdef TLD_METRICS
+  tld.getMetrics().close();
+#endif
+  printf("Detection rate: %d/%d\n",detections,nframes);
+  if (nframes>1)
+    printf("Mean processing time: %.2fms (%.1f fps)\n",total/(nframes-1),1000.0*(nframes-1)/max(total,1e-3));
+  return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * tld_metrics.cpp
+ */
+
+#include <tld_metrics.h>
+#include <string.h>
+
+MetricsLog::MetricsLog(int capacity):ring(capacity>0 ? capacity : 1),head(-1),count(0),frames(0),csv(NULL){
+}
+
+MetricsLog::~MetricsLog(){
+  close();
+}
+
+void MetricsLog::next(){
+  if (csv && count>0)
+    writeRecord(csv,ring[head]);
+  head = (head+1)%(int)ring.size();
+  if (count<(int)ring.size())
+    count++;
+  memset(&ring[head],0,sizeof(FrameMetrics));
+  ring[head].frame = frames++;
+}
+
+bool MetricsLog::open(const char* path){
+  close();
+  csv = fopen(path,"w");
+  if (!csv)
+    return false;
+  writeCSVHeader(csv);
+  return true;
+}
+
+void MetricsLog::close(){
+  if (!csv)
+    return;
+  if (count>0)
+    writeRecord(csv,ring[head]);
+  fclose(csv);
+  csv = NULL;
+}
+
+void MetricsLog::writeCSVHeader(FILE* f){
+  fprintf(f,"frame,tracked,tracked_points,scanned_boxes,var_passed,fern_detections,nn_matches,clusters,"
+            "learn_status,pex,nex,nn_int8_err,track_ms,fern_ms,nn_ms,cluster_ms,learn_ms,total_ms\n");
+}
+
+void MetricsLog::writeRecord(FILE* f,const FrameMetrics& m) const {
+  fprintf(f,"%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+          m.frame,m.tracked,m.tracked_points,m.scanned_boxes,m.var_passed,m.fern_detections,m.nn_matches,m.clusters,
+          m.learn_status,m.pex,m.nex,m.nn_int8_err,m.track_ms,m.fern_ms,m.nn_ms,m.cluster_ms,m.learn_ms,m.total_ms);
+}
+
+void MetricsLog::writeCSV(FILE* f) const {
+  writeCSVHeader(f);
+  for (int i=0;i<count;i++)
+    writeRecord(f,at(i));
+}
@@ -1,4 +1,11 @@
 #include <tld_utils.h>
+#include <stdio.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace cv;
 using namespace std;
 
@@ -36,3 +43,66 @@ vector<int> index_shuffle(int begin,int end){
   return indexes;
 }
 
+bool MappedFile::open(const char* path){
+  close();
+#ifndef _WIN32
+  int fd = ::open(path,O_RDONLY);
+  if (fd<0)
+    return false;
+  struct stat st;
+  if (fstat(fd,&st)<0 || st.st_size==0){
+      ::close(fd);
+      return false;
+  }
+  //Private writable mapping: pages are shared with the page cache until someone writes to them
+  void* p = mmap(NULL,st.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+  ::close(fd);
+  if (p==MAP_FAILED)
+    return false;
+  ptr = (uchar*)p;
+  len = st.st_size;
+  mapped = true;
+  return true;
+#else
+  FILE* f = fopen(path,"rb");
+  if (!f)
+    return false;
+  fseek(f,0,SEEK_END);
+  long n = ftell(f);
+  fseek(f,0,SEEK_SET);
+  if (n<=0){
+      fclose(f);
+      return false;
+  }
+  ptr = new uchar[n];
+  len = fread(ptr,1,n,f);
+  fclose(f);
+  if (len!=(size_t)n){
+      close();
+      return false;
+  }
+  return true;
+#endif
+}
+
+void MappedFile::close(){
+  if (!ptr)
+    return;
+#ifndef _WIN32
+  if (mapped)
+    munmap(ptr,len);
+  else
+#endif
+    delete[] ptr;
+  ptr = NULL;
+  len = 0;
+  mapped = false;
+}
+
+void writePadding(FILE* f,int align){
+  static const char zeros[64] = {0};
+  long pos = ftell(f);
+  if (pos<0)
+    return;
+  fwrite(zeros,1,(align-pos%align)%align,f);
+}
@@ -24,17 +24,7 @@ if isempty(bb2)
     return;
 end
 
-switch size(bb2,2)
-    case 0, T = [];
-    case 1, T = 1;
-    case 2
-        T = ones(2,1);
-        if bb_distance(bb2) > SPACE_THR, T(2) = 2; end
-    otherwise
-        bbd = bb_distance(bb2);
-        Z = linkagemex(bbd,'si');
-        T = cluster(Z,'cutoff', SPACE_THR,'criterion','distance');
-end
+T = bb_cluster_overlap(bb2,SPACE_THR); % single linkage on bb_distance, cut at SPACE_THR
 uT = unique(T);
 
 % Merge clusters
@@ -30,17 +30,7 @@ if isempty(iBB)
     return;
 end
 
-switch size(iBB,2)
-    case 0, T = [];
-    case 1, T = 1;
-    case 2
-        T = ones(2,1);
-        if bb_distance(iBB) > SPACE_THR, T(2) = 2; end
-    otherwise
-        bbd = bb_distance(iBB);
-        Z = linkagemex(bbd,'si');
-        T = cluster(Z,'cutoff', SPACE_THR,'criterion','distance');
-end
+T = bb_cluster_overlap(iBB,SPACE_THR); % single linkage on bb_distance, cut at SPACE_THR
 
 idx_cluster  = unique(T);
 num_clusters = length(idx_cluster);
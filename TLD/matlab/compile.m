@@ -23,67 +23,42 @@ if ispc
     include = ' -Ic:\OpenCV2.2\include\opencv\ -Ic:\OpenCV2.2\include\';
     libpath = 'c:\OpenCV2.2\lib\';
     files = dir([libpath '*.lib']);
-    
-    lib = [];
-    for i = 1:length(files),
-        lib = [lib ' ' libpath files(i).name];
-    end
-    
-    eval(['mex lk.cpp -O' include lib]);
-    mex -O -c tld.cpp
-    mex -O fern.cpp tld.obj
-    mex -O linkagemex.cpp
-    mex -O bb_overlap.cpp
-    mex -O warp.cpp
-    mex -O distance.cpp
-end
-
-if ismac
+    obj = '.obj';
+    cxx = '';
+elseif ismac
     disp('Mac');
-    
     include = ' -I/opt/local/include/opencv/ -I/opt/local/include/'; 
     libpath = '/opt/local/lib/'; 
-    
     files = dir([libpath 'libopencv*.dylib']);
-    
-    lib = [];
-    for i = 1:length(files),
-        lib = [lib ' ' libpath files(i).name];
-    end
-    
-    eval(['mex lk.cpp -O' include lib]);
-    mex -O -c tld.cpp
-    mex -O fern.cpp tld.o
-    mex -O linkagemex.cpp
-    mex -O bb_overlap.cpp
-    mex -O warp.cpp
-    mex -O distance.cpp
-    
-end
-
-if isunix
+    obj = '.o';
+    cxx = ' CXXFLAGS=''$CXXFLAGS -std=c++11''';
+else
     disp('Unix');
-    
     include = ' -I/usr/local/include/opencv/ -I/usr/local/include/';
     libpath = '/usr/local/lib/';
-    
     files = dir([libpath 'libopencv*.so.2.2']);
-    
-    lib = [];
-    for i = 1:length(files),
-        lib = [lib ' ' libpath files(i).name];
-    end
-    
-    eval(['mex lk.cpp -O' include lib]);
-    mex -O -c tld.cpp
-    mex -O fern.cpp tld.o
-    mex -O linkagemex.cpp
-    mex -O bb_overlap.cpp
-    mex -O warp.cpp
-    mex -O distance.cpp
-    
+    obj = '.o';
+    cxx = ' CXXFLAGS=''$CXXFLAGS -std=c++11 -pthread'' LDFLAGS=''$LDFLAGS -pthread''';
 end
 
+lib = [];
+for i = 1:length(files),
+    lib = [lib ' ' libpath files(i).name];
+end
+
+% MATLAB-free kernels (core/), the mex files are thin wrappers around them
+eval(['mex -O -c core/lk_core.cpp' include]);
+mex -O -c tld.cpp
+eval(['mex -O -c core/fern_core.cpp core/worker_pool.cpp' cxx]);
+mex -O -c core/linkage_core.cpp core/bb_overlap_core.cpp core/bb_cluster_core.cpp core/warp_core.cpp core/distance_core.cpp
+
+eval(['mex lk.cpp -O lk_core' obj include lib]);
+eval(['mex -O fern.cpp fern_core' obj ' worker_pool' obj ' tld' obj cxx]);
+eval(['mex -O linkagemex.cpp linkage_core' obj]);
+eval(['mex -O bb_overlap.cpp bb_overlap_core' obj]);
+eval(['mex -O bb_cluster_overlap.cpp bb_cluster_core' obj ' bb_overlap_core' obj]);
+eval(['mex -O warp.cpp warp_core' obj]);
+eval(['mex -O distance.cpp distance_core' obj]);
 
 cd ..
 disp('Compilation finished.');
@@ -20,37 +20,8 @@ function patch = img_patch(img, bb, randomize,p_par)
 
 if nargin == 4 && randomize > 0
     
-    rand('state',randomize);
-    randn('state',randomize);
-    
-    NOISE = p_par.noise;
-    ANGLE = p_par.angle;
-    SCALE = p_par.scale;
-    SHIFT = p_par.shift;
-    
-    cp  = bb_center(bb)-1;
-    Sh1 = [1 0 -cp(1); 0 1 -cp(2); 0 0 1];
-    
-    sca = 1-SCALE*(rand-0.5);
-    Sca = diag([sca sca 1]);
-    
-    ang = 2*pi/360*ANGLE*(rand-0.5);
-    ca = cos(ang);
-    sa = sin(ang);
-    Ang = [ca, -sa; sa, ca];
-    Ang(end+1,end+1) = 1;
-    
-    shR  = SHIFT*bb_height(bb)*(rand-0.5);
-    shC  = SHIFT*bb_width(bb)*(rand-0.5);
-    Sh2 = [1 0 shC; 0 1 shR; 0 0 1];
-    
-    bbW = bb_width(bb)-1;
-    bbH = bb_height(bb)-1;
-    box = [-bbW/2 bbW/2 -bbH/2 bbH/2];
-    
-    H     = Sh2*Ang*Sca*Sh1;
-    bbsize = bb_size(bb);
-    patch = uint8(warp(img,inv(H),box) + NOISE*randn(bbsize(1),bbsize(2)));
+    [Hinv,box,noise] = img_warp_params(bb,randomize,p_par);
+    patch = uint8(warp(img,Hinv,box) + noise);
     
     
 else
@@ -0,0 +1,53 @@
+% Copyright 2011 Zdenek Kalal
+%
+% This file is part of TLD.
+% 
+% TLD is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+% 
+% TLD is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+% 
+% You should have received a copy of the GNU General Public License
+% along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+function [Hinv,box,noise] = img_warp_params(bb, randomize, p_par)
+% Random warp used by img_patch(img,bb,randomize,p_par), without applying it:
+% patch = uint8(warp(img,Hinv,box) + noise)
+
+rand('state',randomize);
+randn('state',randomize);
+
+NOISE = p_par.noise;
+ANGLE = p_par.angle;
+SCALE = p_par.scale;
+SHIFT = p_par.shift;
+
+cp  = bb_center(bb)-1;
+Sh1 = [1 0 -cp(1); 0 1 -cp(2); 0 0 1];
+
+sca = 1-SCALE*(rand-0.5);
+Sca = diag([sca sca 1]);
+
+ang = 2*pi/360*ANGLE*(rand-0.5);
+ca = cos(ang);
+sa = sin(ang);
+Ang = [ca, -sa; sa, ca];
+Ang(end+1,end+1) = 1;
+
+shR  = SHIFT*bb_height(bb)*(rand-0.5);
+shC  = SHIFT*bb_width(bb)*(rand-0.5);
+Sh2 = [1 0 shC; 0 1 shR; 0 0 1];
+
+bbW = bb_width(bb)-1;
+bbH = bb_height(bb)-1;
+box = [-bbW/2 bbW/2 -bbH/2 bbH/2];
+
+H      = Sh2*Ang*Sca*Sh1;
+Hinv   = inv(H);
+bbsize = bb_size(bb);
+noise  = NOISE*randn(bbsize(1),bbsize(2));
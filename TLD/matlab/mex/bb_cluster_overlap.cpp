@@ -0,0 +1,46 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#ifdef _CHAR16T
+#define CHAR16_T
+#endif
+#include "mex.h" 
+#include "core/bb_cluster_core.h"
+
+// T = bb_cluster_overlap(bb,cutoff)
+// Single linkage on 1-bb_overlap cut at cutoff; same partition as
+// cluster(linkagemex(1-bb_overlap(bb),'si'),'cutoff',cutoff,'criterion','distance')
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs != 2) {
+		mexPrintf("T = bb_cluster_overlap(bb,cutoff)\n");
+		return;
+	}
+
+	double *bb = mxGetPr(prhs[0]);
+	int M = mxGetM(prhs[0]);
+	int N = mxGetN(prhs[0]);
+	if (N > 0 && M < 4) {
+		mexPrintf("bb_cluster_overlap: bounding boxes have to be 4xN.\n");
+		return;
+	}
+
+	plhs[0] = mxCreateDoubleMatrix(N, 1, mxREAL);
+	bb_cluster_overlap(bb,M,N,*mxGetPr(prhs[1]),mxGetPr(plhs[0]));
+}
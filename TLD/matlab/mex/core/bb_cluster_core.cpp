@@ -0,0 +1,89 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <vector>
+#include <algorithm>
+#include "bb_cluster_core.h"
+#include "bb_overlap_core.h"
+using namespace std;
+
+static int find_root(vector<int> &parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+static void join(vector<int> &parent, vector<int> &rank, int a, int b) {
+	a = find_root(parent,a);
+	b = find_root(parent,b);
+	if (a == b) return;
+	if (rank[a] < rank[b]) swap(a,b);
+	parent[b] = a;
+	if (rank[a] == rank[b]) rank[a]++;
+}
+
+struct LeftEdgeLess {
+	const double *bb;
+	int M;
+	bool operator()(int a, int b) const { return bb[a*M] < bb[b*M]; }
+};
+
+int bb_cluster_overlap(const double *bb, int M, int N, double cutoff, double *labels) {
+
+	if (N <= 0) return 0;
+
+	vector<int> parent(N), rank(N,0);
+	for (int i = 0; i < N; i++) parent[i] = i;
+
+	// cluster() links boxes whose distance 1-overlap is strictly below the cutoff
+	double minOverlap = 1 - cutoff;
+	if (minOverlap < 0) {
+		// even disjoint boxes (distance 1) are below the cutoff
+		for (int i = 0; i < N; i++) parent[i] = 0;
+	} else {
+		// linked boxes have a positive overlap and intersect, so along x only the boxes
+		// starting before the right edge of the current one need to be tested
+		vector<int> order(N);
+		for (int i = 0; i < N; i++) order[i] = i;
+		LeftEdgeLess less = {bb,M};
+		sort(order.begin(),order.end(),less);
+
+		for (int a = 0; a < N; a++) {
+			const double *bbA = bb + M*order[a];
+			for (int b = a+1; b < N; b++) {
+				const double *bbB = bb + M*order[b];
+				if (bbB[0] > bbA[2]) break;
+				if (bbB[1] > bbA[3] || bbB[3] < bbA[1]) continue;
+				if (find_root(parent,order[a]) == find_root(parent,order[b])) continue;
+				if (bb_overlap(bbA,bbB) > minOverlap) join(parent,rank,order[a],order[b]);
+			}
+		}
+	}
+
+	// number the clusters in the order of their first box
+	vector<int> label(N,0);
+	int nClusters = 0;
+	for (int i = 0; i < N; i++) {
+		int r = find_root(parent,i);
+		if (label[r] == 0) label[r] = ++nClusters;
+		labels[i] = label[r];
+	}
+	return nClusters;
+}
@@ -0,0 +1,29 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+// Single-linkage clustering of bounding boxes on the distance 1 - bb_overlap, free of MATLAB.
+// Cutting the single-linkage tree at a distance is the same as taking the connected components
+// of the graph that links boxes closer than the cutoff, i.e. the minimum spanning forest of that graph.
+// The graph is built by a sweep over the boxes sorted by their left edge, so only boxes that
+// intersect are ever compared, and components are joined by union-find.
+
+#pragma once
+
+// labels (N) = 1-based cluster of every column of bb (M x N, [x1 y1 x2 y2 ...]), two boxes sharing a
+// cluster when they are linked by a chain of boxes with 1 - bb_overlap < cutoff (strict, as in MATLAB cluster).
+// Clusters are numbered in the order of their first box. Returns the number of clusters.
+int bb_cluster_overlap(const double *bb, int M, int N, double cutoff, double *labels);
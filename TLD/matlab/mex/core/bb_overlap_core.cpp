@@ -0,0 +1,73 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include "bb_overlap_core.h"
+using namespace std;
+
+double bb_overlap(const double *bb1, const double *bb2) {
+
+	if (bb1[0] > bb2[2]) { return 0.0; }
+	if (bb1[1] > bb2[3]) { return 0.0; }
+	if (bb1[2] < bb2[0]) { return 0.0; }
+	if (bb1[3] < bb2[1]) { return 0.0; }
+	
+	double colInt =  min(bb1[2], bb2[2]) - max(bb1[0], bb2[0]) + 1;
+	double rowInt =  min(bb1[3], bb2[3]) - max(bb1[1], bb2[1]) + 1;
+
+	double intersection = colInt * rowInt;
+	double area1 = (bb1[2]-bb1[0]+1)*(bb1[3]-bb1[1]+1);
+	double area2 = (bb2[2]-bb2[0]+1)*(bb2[3]-bb2[1]+1);
+	return intersection / (area1 + area2 - intersection);
+}
+
+void bb_overlap_pairs(const double *bb, int mBB, int nBB, double *out) {
+	for (int i = 0; i < nBB-1; i++) {
+		for (int j = i+1; j < nBB; j++) {
+			*out++ = bb_overlap(bb + mBB*i, bb + mBB*j);
+		}
+	}
+}
+
+void bb_overlap_matrix(const double *bb1, int M1, int N1, const double *bb2, int M2, int N2, double *out) {
+	for (int j = 0; j < N2; j++) {
+		for (int i = 0; i < N1; i++) {
+			*out++ = bb_overlap(bb1 + M1*i, bb2 + M2*j);
+		}
+	}
+}
+
+void bb_overlap_dot(const double *bb1, int M1, const double *bb2, int M2, int N, double *out) {
+	for (int j = 0; j < N; j++) {
+		*out++ = bb_overlap(bb1 + M1*j, bb2 + M2*j);
+	}
+}
+
+void bb_overlap_best(const double *bb1, int M1, int N1, const double *bb2, int M2, int N2, double *out) {
+	for (int j = 0; j < N1; j++) {
+		double maxOvrlp = 0;
+		out[j] = 0;
+		for (int i = 0; i < N2; i++) {
+			double overlap = bb_overlap(bb1 + M1*j, bb2 + M2*i);
+			if (overlap > maxOvrlp) {
+				maxOvrlp = overlap;
+				out[j] = i+1.0;
+			}
+		}
+	}
+}
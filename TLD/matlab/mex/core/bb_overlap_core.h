@@ -0,0 +1,32 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+// Bounding box overlap, free of MATLAB.
+// Boxes are [x1 y1 x2 y2 ...] columns of M rows, stored column-major.
+
+#pragma once
+
+double bb_overlap(const double *bb1, const double *bb2);
+
+// out (nBB*(nBB-1)/2) = overlap of every pair of columns, in pdist order
+void bb_overlap_pairs(const double *bb, int mBB, int nBB, double *out);
+// out (N1 x N2, column-major) = overlap of every column of bb1 with every column of bb2
+void bb_overlap_matrix(const double *bb1, int M1, int N1, const double *bb2, int M2, int N2, double *out);
+// out (N) = overlap of the j-th columns of bb1 and bb2
+void bb_overlap_dot(const double *bb1, int M1, const double *bb2, int M2, int N, double *out);
+// out (N1) = 1-based index of the column of bb2 that overlaps the most with each column of bb1, 0 if none
+void bb_overlap_best(const double *bb1, int M1, int N1, const double *bb2, int M2, int N2, double *out);
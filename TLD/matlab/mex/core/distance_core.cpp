@@ -0,0 +1,212 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "distance_core.h"
+using namespace std;
+
+#if defined(TLD_BLAS)
+#include <stddef.h>
+extern "C" void dgemm_(const char *transa, const char *transb, const ptrdiff_t *m, const ptrdiff_t *n, const ptrdiff_t *k,
+                       const double *alpha, const double *a, const ptrdiff_t *lda, const double *b, const ptrdiff_t *ldb,
+                       const double *beta, double *c, const ptrdiff_t *ldc);
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VWIDTH 4
+typedef __m256d vdouble;
+static inline vdouble vzero() { return _mm256_setzero_pd(); }
+static inline vdouble vload(const double *p) { return _mm256_loadu_pd(p); }
+static inline vdouble vmadd(vdouble acc, vdouble a, vdouble b) { return _mm256_add_pd(acc,_mm256_mul_pd(a,b)); }
+static inline double vsum(vdouble v) {
+	__m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),_mm256_extractf128_pd(v,1));
+	return _mm_cvtsd_f64(_mm_add_sd(s,_mm_unpackhi_pd(s,s)));
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VWIDTH 2
+typedef __m128d vdouble;
+static inline vdouble vzero() { return _mm_setzero_pd(); }
+static inline vdouble vload(const double *p) { return _mm_loadu_pd(p); }
+static inline vdouble vmadd(vdouble acc, vdouble a, vdouble b) { return _mm_add_pd(acc,_mm_mul_pd(a,b)); }
+static inline double vsum(vdouble v) { return _mm_cvtsd_f64(_mm_add_sd(v,_mm_unpackhi_pd(v,v))); }
+#else
+#define VWIDTH 1
+typedef double vdouble;
+static inline vdouble vzero() { return 0; }
+static inline vdouble vload(const double *p) { return *p; }
+static inline vdouble vmadd(vdouble acc, vdouble a, vdouble b) { return acc + a*b; }
+static inline double vsum(vdouble v) { return v; }
+#endif
+
+// correlation
+double ccorr(const double *f1,const double *f2,int numDim) {
+	double f = 0;
+	for (int i = 0; i<numDim; i++) {
+		f += f1[i]*f2[i];
+	}
+	return f;
+}
+
+// correlation normalized
+double ccorr_normed(const double *f1,const double *f2,int numDim) {
+	double corr = 0;
+	double norm1 = 0;
+	double norm2 = 0;
+
+	for (int i = 0; i<numDim; i++) {
+		corr += f1[i]*f2[i];
+		norm1 += f1[i]*f1[i];
+		norm2 += f2[i]*f2[i];
+	}
+	// normalization to <0,1>
+	return (corr / sqrt(norm1*norm2) + 1) / 2.0;
+}
+
+// euclidean distance
+double euclidean(const double *f1,const double *f2,int numDim) {
+
+	double sum = 0;
+	for (int i = 0; i<numDim; i++) {
+		sum += (f1[i]-f2[i])*(f1[i]-f2[i]);
+	}
+	return sqrt(sum);
+}
+
+void column_norms(const double *x,int N,int M,double *norm2) {
+	for (int i = 0; i < N; i++) {
+		const double *f = x+i*M;
+		vdouble acc = vzero();
+		int k = 0;
+		for (; k+VWIDTH <= M; k += VWIDTH) {
+			vdouble v = vload(f+k);
+			acc = vmadd(acc,v,v);
+		}
+		double s = vsum(acc);
+		for (; k < M; k++) s += f[k]*f[k];
+		norm2[i] = s;
+	}
+}
+
+// out(i,j) = a(:,i)'*b(:,j) for NA columns of a and NB columns of b; out has leading dimension ldo
+template<int NA, int NB>
+static void dot_block(const double *a, const double *b, int M, double *out, int ldo) {
+	vdouble acc[NA][NB];
+	for (int i = 0; i < NA; i++)
+		for (int j = 0; j < NB; j++)
+			acc[i][j] = vzero();
+
+	int k = 0;
+	for (; k+VWIDTH <= M; k += VWIDTH) {
+		vdouble va[NA];
+		for (int i = 0; i < NA; i++) va[i] = vload(a+i*M+k);
+		for (int j = 0; j < NB; j++) {
+			vdouble vb = vload(b+j*M+k);
+			for (int i = 0; i < NA; i++) acc[i][j] = vmadd(acc[i][j],va[i],vb);
+		}
+	}
+	for (int i = 0; i < NA; i++) {
+		for (int j = 0; j < NB; j++) {
+			double s = vsum(acc[i][j]);
+			for (int kk = k; kk < M; kk++) s += a[i*M+kk]*b[j*M+kk];
+			out[i+j*ldo] = s;
+		}
+	}
+}
+
+static void dot_block_any(int na, int nb, const double *a, const double *b, int M, double *out, int ldo) {
+	if (na == 2) {
+		switch (nb) {
+		case 4: dot_block<2,4>(a,b,M,out,ldo); return;
+		case 3: dot_block<2,3>(a,b,M,out,ldo); return;
+		case 2: dot_block<2,2>(a,b,M,out,ldo); return;
+		case 1: dot_block<2,1>(a,b,M,out,ldo); return;
+		}
+	}
+	switch (nb) {
+	case 4: dot_block<1,4>(a,b,M,out,ldo); return;
+	case 3: dot_block<1,3>(a,b,M,out,ldo); return;
+	case 2: dot_block<1,2>(a,b,M,out,ldo); return;
+	case 1: dot_block<1,1>(a,b,M,out,ldo); return;
+	}
+}
+
+void column_dots(const double *x1,int N1,const double *x2,int N2,int M,double *resp) {
+	if (N1 <= 0 || N2 <= 0) return;
+
+#if defined(TLD_BLAS)
+	const char transa = 'T', transb = 'N';
+	const double one = 1.0, zero = 0.0;
+	ptrdiff_t m = N1, n = N2, k = M, lda = M, ldb = M, ldc = N1;
+	dgemm_(&transa,&transb,&m,&n,&k,&one,x1,&lda,x2,&ldb,&zero,resp,&ldc);
+#else
+	// a tile of x2 columns (~128 kB) stays in L2 while all columns of x1 stream past it;
+	// 2x4 register blocks reuse every loaded vector of x1 four times and of x2 twice
+	const int TILE_BYTES = 128*1024;
+	int tile = max(4,(TILE_BYTES/(int) sizeof(double))/max(M,1));
+	tile -= tile % 4;
+
+	for (int j0 = 0; j0 < N2; j0 += tile) {
+		int j1 = min(N2,j0+tile);
+		for (int i = 0; i < N1; i += 2) {
+			int na = min(2,N1-i);
+			for (int j = j0; j < j1; j += 4) {
+				int nb = min(4,j1-j);
+				dot_block_any(na,nb,x1+i*M,x2+j*M,M,resp+i+j*N1,N1);
+			}
+		}
+	}
+#endif
+}
+
+bool distance(const double *x1,int N1,const double *x2,int N2,int M,int type,double *resp) {
+
+	if (type != DISTANCE_NCC && type != DISTANCE_EUCLIDEAN) return false;
+
+	vector<double> norm1(N1), norm2(N2);
+	column_norms(x1,N1,M,N1 ? &norm1[0] : 0);
+	column_norms(x2,N2,M,N2 ? &norm2[0] : 0);
+	column_dots(x1,N1,x2,N2,M,resp);
+
+	switch (type)
+	{
+	case DISTANCE_NCC :
+		for (int i = 0; i < N1; i++) norm1[i] = sqrt(norm1[i]);
+		for (int j = 0; j < N2; j++) norm2[j] = sqrt(norm2[j]);
+		for (int j = 0; j < N2; j++) {
+			double *r = resp+j*N1;
+			for (int i = 0; i < N1; i++) {
+				// normalization to <0,1>
+				r[i] = (r[i] / (norm1[i]*norm2[j]) + 1) / 2.0;
+			}
+		}
+		return true;
+	case DISTANCE_EUCLIDEAN :
+		for (int j = 0; j < N2; j++) {
+			double *r = resp+j*N1;
+			for (int i = 0; i < N1; i++) {
+				r[i] = sqrt(max(0.0,norm1[i] + norm2[j] - 2*r[i]));
+			}
+		}
+		return true;
+	}
+	return false;
+}
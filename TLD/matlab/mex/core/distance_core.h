@@ -0,0 +1,40 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+// Distances between column sets, free of MATLAB.
+// The column sets are compared through their inner products: norms are computed once per column,
+// the products run in cache tiles through a SIMD kernel (or dgemm when built with TLD_BLAS).
+
+#pragma once
+
+enum DistanceType {
+	DISTANCE_NCC = 1,       // normalized correlation mapped to <0,1>
+	DISTANCE_EUCLIDEAN = 2
+};
+
+double ccorr(const double *f1,const double *f2,int numDim);
+double ccorr_normed(const double *f1,const double *f2,int numDim);
+double euclidean(const double *f1,const double *f2,int numDim);
+
+// norm2 (N) = squared norms of the columns of x (M x N)
+void column_norms(const double *x,int N,int M,double *norm2);
+// resp (N1 x N2, column-major) = x1' * x2
+void column_dots(const double *x1,int N1,const double *x2,int N2,int M,double *resp);
+
+// resp (N1 x N2, column-major) = similarity/distance between the columns of x1 (M x N1) and x2 (M x N2)
+// Returns false for an unknown type.
+bool distance(const double *x1,int N1,const double *x2,int N2,int M,int type,double *resp);
@@ -0,0 +1,272 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "fern_core.h"
+#include "../tld.h"
+using namespace std;
+
+#define sub2idx(row,col,height) ((int) (floor((row)+0.5) + floor((col)+0.5)*(height)))
+
+FernContext::FernContext() : threads(1) {
+	clear();
+}
+
+void FernContext::setThreads(int n) {
+	if (n < 0) n = 1;
+	if (n != threads) pool.reset();
+	threads = n;
+}
+
+void FernContext::clear() {
+	thrN = 0; nBBOX = 0; mBBOX = 0; nTREES = 0; nFEAT = 0; nSCALE = 0; iHEIGHT = 0; iWIDTH = 0;
+	BBOX.clear();
+	OFF.clear();
+	IIMG.clear();
+	IIMG2.clear();
+	WEIGHT.clear();
+	nP.clear();
+	nN.clear();
+	samples.clear();
+	pool.reset();
+}
+
+void FernContext::init(int height, int width, const double *bb, int mBB, int nBB,
+                       const double *features, int nFeat, int nTrees, const double *scales, int nScales) {
+
+	iHEIGHT    = height;
+	iWIDTH     = width;
+	nTREES     = nTrees;
+	nFEAT      = nFeat;
+	thrN       = 0.5 * nTREES;
+	nSCALE     = nScales;
+
+	IIMG.assign(iHEIGHT*iWIDTH,0);
+	IIMG2.assign(iHEIGHT*iWIDTH,0);
+
+	// BBOX
+	mBBOX      = mBB;
+	nBBOX      = nBB;
+	BBOX.resize(BBOX_STEP*nBBOX);
+	int *off   = &BBOX[0];
+	for (int i = 0; i < nBBOX; i++) {
+		const double *b = bb+mBBOX*i;
+		*off++ = sub2idx(b[1]-1,b[0]-1,iHEIGHT);
+		*off++ = sub2idx(b[3]-1,b[0]-1,iHEIGHT);
+		*off++ = sub2idx(b[1]-1,b[2]-1,iHEIGHT);
+		*off++ = sub2idx(b[3]-1,b[2]-1,iHEIGHT);
+		*off++ = (int) ((b[2]-b[0])*(b[3]-b[1]));
+		*off++ = (int) (b[4]-1)*2*nFEAT*nTREES; // pointer to features for this scale
+		*off++ = (int) b[5]; // number of left-right bboxes, will be used for searching neighbours
+	}
+
+	// feature offsets for every scale
+	OFF.resize(nSCALE*nTREES*nFEAT*2);
+	off = &OFF[0];
+	for (int k = 0; k < nSCALE; k++){
+		const double *scale = scales+2*k;
+		for (int i = 0; i < nTREES; i++) {
+			for (int j = 0; j < nFEAT; j++) {
+				const double *x  = features +4*j + (4*nFEAT)*i;
+				*off++ = sub2idx((scale[0]-1)*x[1],(scale[1]-1)*x[0],iHEIGHT);
+				*off++ = sub2idx((scale[0]-1)*x[3],(scale[1]-1)*x[2],iHEIGHT);
+			}
+		}
+	}
+
+	int nCodes = (int) pow(2.0,nBIT*nFEAT);
+	WEIGHT.assign(nTREES,vector<double>(nCodes,0));
+	nP.assign(nTREES,vector<int>(nCodes,0));
+	nN.assign(nTREES,vector<int>(nCodes,0));
+}
+
+void FernContext::update(const double *x, int C, int N) {
+	for (int i = 0; i < nTREES; i++) {
+
+		int idx = (int) x[i];
+
+		(C==1) ? nP[i][idx] += N : nN[i][idx] += N;
+
+		if (nP[i][idx]==0) {
+			WEIGHT[i][idx] = 0;
+		} else {
+			WEIGHT[i][idx] = ((double) (nP[i][idx])) / (nP[i][idx] + nN[i][idx]);
+		}
+	}
+}
+
+double FernContext::measure_forest(const double *idx) const {
+	double votes = 0;
+	for (int i = 0; i < nTREES; i++) {
+		votes += WEIGHT[i][(int) idx[i]];
+	}
+	return votes;
+}
+
+int FernContext::measure_tree_offset(const unsigned char *img, int idx_bbox, int idx_tree) const {
+
+	int index = 0;
+	const int *bbox = &BBOX[idx_bbox*BBOX_STEP];
+	const int *off = &OFF[bbox[5] + idx_tree*2*nFEAT];
+	for (int i=0; i<nFEAT; i++) {
+		index<<=1;
+		int fp0 = img[off[0]+bbox[0]];
+		int fp1 = img[off[1]+bbox[0]];
+		if (fp0>fp1) { index |= 1;}
+		off += 2;
+	}
+	return index;
+}
+
+double FernContext::measure_bbox_offset(const unsigned char *blur, int idx_bbox, double minVar, double *tPatt) const {
+
+	double conf = 0.0;
+	double bboxvar = bbox_var_offset(&IIMG[0],&IIMG2[0],&BBOX[idx_bbox*BBOX_STEP]);
+	if (bboxvar < minVar) {	return conf; }
+
+	for (int i = 0; i < nTREES; i++) {
+		int idx = measure_tree_offset(blur,idx_bbox,i);
+		tPatt[i] = idx;
+		conf += WEIGHT[i][idx];
+	}
+	return conf;
+}
+
+void FernContext::integral(const unsigned char *input) {
+	iimg(input,&IIMG[0],iHEIGHT,iWIDTH);
+	iimg2(input,&IIMG2[0],iHEIGHT,iWIDTH);
+}
+
+void FernContext::train(const double *X, int numX, const double *Y, double margin, int bootstrap, const double *idx, int nIdx) {
+
+	double thrP = margin * nTREES;
+
+	if (idx == 0) {
+		int step = numX / 10;
+		for (int j = 0; j < bootstrap; j++) {
+			for (int i = 0; i < step; i++) {
+				for (int k = 0; k < 10; k++) {
+
+					int I = k*step + i;
+					const double *x = X+nTREES*I;
+					if (Y[I] == 1) {
+						if (measure_forest(x) <= thrP)
+							update(x,1,1);
+					} else {
+						if (measure_forest(x) >= thrN)
+							update(x,0,1);
+					}
+				}
+			}
+		}
+		return;
+	}
+
+	for (int j = 0; j < bootstrap; j++) {
+		for (int i = 0; i < nIdx; i++) {
+			int I = (int) idx[i]-1;
+			const double *x = X+nTREES*I;
+			if (Y[I] == 1) {
+				if (measure_forest(x) <= thrP)
+					update(x,1,1);
+			} else {
+				if (measure_forest(x) >= thrN)
+					update(x,0,1);
+			}
+		}
+	}
+}
+
+void FernContext::evaluate(const double *X, int numX, double *conf) const {
+	for (int i = 0; i < numX; i++) {
+		*conf++ = measure_forest(X+nTREES*i);
+	}
+}
+
+void FernContext::detect(const unsigned char *input, const unsigned char *blur, double probability, double offset,
+                         double minVar, double *conf, double *patt) {
+
+	for (int i = 0; i < nBBOX; i++) { conf[i] = -1; }
+
+	// Setup sampling of the BBox
+	double nTest  = nBBOX * probability; if (nTest <= 0) return;
+	if (nTest > nBBOX) nTest = nBBOX;
+	double pStep  = (double) nBBOX / nTest;
+	double pState = offset * pStep;
+
+	// Integral images
+	integral(input);
+
+	// Indexes of the sampled bboxes, listed serially so that the sampling does not depend on threads
+	samples.clear();
+	while (1)
+	{
+		int I = (int) floor(pState);
+		pState += pStep;
+		if (pState >= nBBOX) { break; }
+		samples.push_back(I);
+	}
+	int nSamples = (int) samples.size();
+	if (nSamples == 0) return;
+
+	if (threads == 1) {
+		for (int k = 0; k < nSamples; k++) {
+			int I = samples[k];
+			conf[I] = measure_bbox_offset(blur,I,minVar,patt + nTREES*I);
+		}
+		return;
+	}
+
+	// Contiguous slices of the sample list; a slice owns conf[I] and patt(:,I) of its boxes
+	if (!pool) pool.reset(new WorkerPool(threads));
+	const int SLICES_PER_THREAD = 4;
+	int nSlices = min(nSamples,pool->size()*SLICES_PER_THREAD);
+	pool->run(nSlices,[&](int slice) {
+		int first = (int) ((long long) nSamples*slice/nSlices);
+		int last  = (int) ((long long) nSamples*(slice+1)/nSlices);
+		for (int k = first; k < last; k++) {
+			int I = samples[k];
+			conf[I] = measure_bbox_offset(blur,I,minVar,patt + nTREES*I);
+		}
+	});
+}
+
+void FernContext::patterns(const unsigned char *input, const unsigned char *blur, const double *idx, int numIdx,
+                           double minVar, double *patt, double *status) {
+
+	if (minVar > 0) {
+		integral(input);
+	}
+	memset(patt,0,nTREES*numIdx*sizeof(double));
+	memset(status,0,numIdx*sizeof(double));
+
+	for (int j = 0; j < numIdx; j++) {
+
+		if (minVar > 0) {
+			double bboxvar = bbox_var_offset(&IIMG[0],&IIMG2[0],&BBOX[j*BBOX_STEP]);
+			if (bboxvar < minVar) {	continue; }
+		}
+		status[j] = 1;
+		double *tPatt = patt + j*nTREES;
+		for (int i = 0; i < nTREES; i++) {
+			tPatt[i] = (double) measure_tree_offset(blur, (int) idx[j]-1, i);
+		}
+	}
+}
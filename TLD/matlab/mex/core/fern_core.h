@@ -0,0 +1,84 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+// Randomized fern forest of the detector, free of MATLAB.
+// All state lives in a FernContext, so independent trackers can run side by side.
+// Images, bounding boxes and patterns use MATLAB's column-major layout and 1-based box coordinates.
+
+#pragma once
+#include <vector>
+#include <memory>
+#include "worker_pool.h"
+
+class FernContext {
+public:
+	static const int BBOX_STEP = 7; // corners, area, scale offset, grid width
+	static const int nBIT = 1;      // number of bits per feature
+
+	double thrN;
+	int nBBOX;
+	int mBBOX;
+	int nTREES;
+	int nFEAT;
+	int nSCALE;
+	int iHEIGHT;
+	int iWIDTH;
+	std::vector<int> BBOX;
+	std::vector<int> OFF;
+	std::vector<double> IIMG;
+	std::vector<double> IIMG2;
+	std::vector<std::vector<double> > WEIGHT;
+	std::vector<std::vector<int> > nP;
+	std::vector<std::vector<int> > nN;
+
+	FernContext();
+	bool initialized() const { return !BBOX.empty(); }
+	void clear();
+	// Worker threads of detect(): 1 = serial, 0 = one per hardware thread.
+	// Each sampled box is written by exactly one thread, so the output does not depend on it.
+	void setThreads(int n);
+	int getThreads() const { return threads; }
+
+	// bb: mBB x nBB grid, features: 4*nFeat x nTrees point pairs, scales: 2 x nScales
+	void init(int height, int width, const double *bb, int mBB, int nBB,
+	          const double *features, int nFeat, int nTrees, const double *scales, int nScales);
+
+	void update(const double *x, int C, int N);
+	double measure_forest(const double *idx) const;
+	int measure_tree_offset(const unsigned char *img, int idx_bbox, int idx_tree) const;
+	double measure_bbox_offset(const unsigned char *blur, int idx_bbox, double minVar, double *tPatt) const;
+	void integral(const unsigned char *input);
+
+	// Bootstrapped update with patterns X (nTREES x numX) and labels Y; idx (1-based) restricts the samples
+	void train(const double *X, int numX, const double *Y, double margin, int bootstrap, const double *idx = 0, int nIdx = 0);
+	void evaluate(const double *X, int numX, double *conf) const;
+	// Scans a regular sample of the grid; offset in [0,1) places the first sample.
+	// conf (nBBOX) and patt (nTREES x nBBOX) are preallocated by the caller.
+	void detect(const unsigned char *input, const unsigned char *blur, double probability, double offset,
+	            double minVar, double *conf, double *patt);
+	// Patterns of the grid boxes idx (1-based); status is 1 for boxes passing the variance filter
+	void patterns(const unsigned char *input, const unsigned char *blur, const double *idx, int numIdx,
+	              double minVar, double *patt, double *status);
+
+private:
+	int threads;
+	std::unique_ptr<WorkerPool> pool;
+	std::vector<int> samples;   // grid boxes visited by detect(), in sampling order
+
+	FernContext(const FernContext&);
+	FernContext& operator=(const FernContext&);
+};
@@ -0,0 +1,25 @@
+/* linkage_core.h - Create hierarchical cluster tree
+
+   Core of linkagemex.cpp without the MATLAB glue.
+   Copyright 2003-2006 The MathWorks, Inc. */
+
+#pragma once
+#include <stddef.h>
+
+enum LinkageMethod {
+    LINKAGE_SINGLE = 0,
+    LINKAGE_COMPLETE,
+    LINKAGE_AVERAGE,
+    LINKAGE_WEIGHTED,
+    LINKAGE_CENTROID,
+    LINKAGE_MEDIAN,
+    LINKAGE_WARD
+};
+
+/* LinkageMethod from its name ("single", "complete", ...), -1 if unknown */
+int linkage_method(const char *method);
+
+/* y:  m*(m-1)/2 pairwise distances in pdist order, used as workspace (overwritten)
+   Z:  (m-1) x 3 output tree, column-major, 1-based cluster indexes as in MATLAB */
+template<class TEMPL>
+void linkage(TEMPL *y, size_t m, int method, TEMPL *Z);
@@ -0,0 +1,137 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "lk_core.h"
+#include "math.h"
+#include <limits>
+
+static void euclideanDistance (const CvPoint2D32f *point1, const CvPoint2D32f *point2, float *match, int nPts) {
+
+	for (int i = 0; i < nPts; i++) {
+
+		match[i] = sqrt((point1[i].x - point2[i].x)*(point1[i].x - point2[i].x) + 
+		(point1[i].y - point2[i].y)*(point1[i].y - point2[i].y) );
+
+	}
+}
+
+static void normCrossCorrelation(IplImage *imgI, IplImage *imgJ, const CvPoint2D32f *points0, const CvPoint2D32f *points1, int nPts, const char *status, float *match,int winsize, int method) {
+
+
+	IplImage *rec0 = cvCreateImage( cvSize(winsize, winsize), 8, 1 );
+	IplImage *rec1 = cvCreateImage( cvSize(winsize, winsize), 8, 1 );
+	IplImage *res  = cvCreateImage( cvSize( 1, 1 ), IPL_DEPTH_32F, 1 );
+
+	for (int i = 0; i < nPts; i++) {
+		if (status[i] == 1) {
+			cvGetRectSubPix( imgI, rec0, points0[i] );
+			cvGetRectSubPix( imgJ, rec1, points1[i] );
+			cvMatchTemplate( rec0,rec1, res, method );
+			match[i] = ((float *)(res->imageData))[0]; 
+
+		} else {
+			match[i] = 0.0;
+		}
+	}
+	cvReleaseImage( &rec0 );
+	cvReleaseImage( &rec1 );
+	cvReleaseImage( &res );
+
+}
+
+LkContext::LkContext() : win_size(4), ncc_size(10) {
+	for (int i = 0; i < MAX_IMG; i++) {
+		IMG[i] = 0;
+		PYR[i] = 0;
+	}
+}
+
+LkContext::~LkContext() {
+	clear();
+}
+
+void LkContext::clear() {
+	for (int i = 0; i < MAX_IMG; i++) {
+		if (IMG[i]) cvReleaseImage(&(IMG[i]));
+		if (PYR[i]) cvReleaseImage(&(PYR[i]));
+	}
+}
+
+void LkContext::load(int k, const unsigned char *values, int height, int width) {
+
+	if (IMG[k] != 0 && (IMG[k]->width != width || IMG[k]->height != height)) {
+		cvReleaseImage(&(IMG[k]));
+		cvReleaseImage(&(PYR[k]));
+	}
+	if (IMG[k] == 0) {
+		CvSize imageSize = cvSize(width,height);
+		IMG[k] = cvCreateImage( imageSize, 8, 1 );
+		PYR[k] = cvCreateImage( imageSize, 8, 1 );
+	}
+
+	IplImage *image = IMG[k];
+	int widthStep = image->widthStep;
+	for(int i=0;i<width;i++)
+		for(int j=0;j<height;j++) 
+			image->imageData[j*widthStep+i] = values[j+i*height];
+}
+
+void LkContext::track(const unsigned char *imgI, const unsigned char *imgJ, int height, int width,
+                      const double *ptsI, const double *ptsJ, int nPts, int level, double *output) {
+
+	double nan = std::numeric_limits<double>::quiet_NaN();
+
+	int I = 0;
+	int J = 1;
+	load(I,imgI,height,width);
+	load(J,imgJ,height,width);
+
+	for (int k = 0; k < 3; k++) points[k].resize(nPts);
+	ncc.resize(nPts);
+	fb.resize(nPts);
+	status.resize(nPts);
+	if (nPts == 0) return;
+
+	for (int i = 0; i < nPts; i++) {
+		points[0][i].x = ptsI[2*i]; points[0][i].y = ptsI[2*i+1]; // template
+		points[1][i].x = ptsJ[2*i]; points[1][i].y = ptsJ[2*i+1]; // target
+		points[2][i].x = ptsI[2*i]; points[2][i].y = ptsI[2*i+1]; // forward-backward
+	}
+
+	cvCalcOpticalFlowPyrLK( IMG[I], IMG[J], PYR[I], PYR[J], &points[0][0], &points[1][0], nPts, cvSize(win_size,win_size), level, &status[0], 0, cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS,20,0.03), CV_LKFLOW_INITIAL_GUESSES);
+	cvCalcOpticalFlowPyrLK( IMG[J], IMG[I], PYR[J], PYR[I], &points[1][0], &points[2][0], nPts, cvSize(win_size,win_size), level, 0     , 0, cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS,20,0.03), CV_LKFLOW_INITIAL_GUESSES | CV_LKFLOW_PYR_A_READY | CV_LKFLOW_PYR_B_READY );
+
+	normCrossCorrelation(IMG[I],IMG[J],&points[0][0],&points[1][0],nPts, &status[0], &ncc[0], ncc_size,CV_TM_CCOEFF_NORMED);
+	euclideanDistance( &points[0][0],&points[2][0],&fb[0],nPts);
+
+	// Output
+	int M = 4;
+	for (int i = 0; i < nPts; i++) {
+		if (status[i] == 1) {
+			output[M*i]   = (double) points[1][i].x;
+			output[M*i+1] = (double) points[1][i].y;
+			output[M*i+2] = (double) fb[i];
+			output[M*i+3] = (double) ncc[i];
+		} else {
+			output[M*i]   = nan;
+			output[M*i+1] = nan;
+			output[M*i+2] = nan;
+			output[M*i+3] = nan;
+		}
+	}
+}
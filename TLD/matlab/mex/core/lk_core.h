@@ -0,0 +1,53 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+// Pyramidal Lucas-Kanade point tracker with forward-backward error and NCC, free of MATLAB.
+// Images and pyramids are owned by an LkContext, so independent trackers can run side by side.
+
+#pragma once
+#include "cv.h"
+#include <vector>
+
+class LkContext {
+public:
+	static const int MAX_IMG = 2;
+
+	LkContext();
+	~LkContext();
+	void clear();
+
+	// imgI, imgJ: height x width uint8 images, column-major (MATLAB layout)
+	// ptsI, ptsJ: 2 x nPts points in I and initial guesses in J
+	// output: 4 x nPts [x y fb ncc] of the tracked points, NaN for the lost ones
+	void track(const unsigned char *imgI, const unsigned char *imgJ, int height, int width,
+	           const double *ptsI, const double *ptsJ, int nPts, int level, double *output);
+
+private:
+	int win_size;
+	int ncc_size;
+	IplImage *IMG[MAX_IMG];
+	IplImage *PYR[MAX_IMG];
+	std::vector<CvPoint2D32f> points[3];
+	std::vector<float> ncc;
+	std::vector<float> fb;
+	std::vector<char> status;
+
+	void load(int k, const unsigned char *values, int height, int width);
+
+	LkContext(const LkContext&);
+	LkContext& operator=(const LkContext&);
+};
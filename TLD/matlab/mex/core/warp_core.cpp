@@ -0,0 +1,205 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <math.h>
+#include "warp_core.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WARP_SSE2
+#endif
+
+// rowwise access
+#define coord(x, y, width, height) (y+x*height)
+#define nextrow(tmp, width, height) ((tmp)+1)
+#define nextcol(tmp, width, height) ((tmp)+height)
+#define nextr_c(tmp, width, height) ((tmp)+height+1)
+
+#define M(r, c) H[c*3+r]
+
+void warp_image_roi(const unsigned char *image, int w, int h, const double *H,
+                    double xmin, double xmax, double ymin, double ymax,
+                    double fill, double *result)
+{
+   double curx, cury, curz, wx, wy, wz, ox, oy, oz;
+   int x, y;
+   const unsigned char *tmp;
+   double *output=result, i, j, xx, yy;
+   /* precalulate necessary constant with respect to i,j offset 
+      translation, H is column oriented (transposed) */   
+   ox = M(0,2);
+   oy = M(1,2);
+   oz = M(2,2);
+
+   yy = ymin;
+   for (j=0; j<(int)(ymax-ymin+1); j++)
+   {
+      /* calculate x, y for current row */
+      curx = M(0,1)*yy + ox;
+      cury = M(1,1)*yy + oy;
+      curz = M(2,1)*yy + oz;
+      xx = xmin; 
+      yy = yy + 1;
+      for (i=0; i<(int)(xmax-xmin+1); i++)
+      {
+         /* calculate x, y in current column */
+         wx = M(0,0)*xx + curx;
+         wy = M(1,0)*xx + cury;
+         wz = M(2,0)*xx + curz;
+         wx /= wz; wy /= wz;
+         xx = xx + 1;
+         
+         x = (int)floor(wx);
+         y = (int)floor(wy);
+
+         if (x>=0 && y>=0)
+         {
+            wx -= x; wy -= y; 
+            if (x+1==w && wx==1)
+               x--;
+            if (y+1==h && wy==1)
+               y--;
+            if ((x+1)<w && (y+1)<h)
+            {
+               tmp = &image[coord(x,y,w,h)];
+               /* image[x,y]*(1-wx)*(1-wy) + image[x+1,y]*wx*(1-wy) +
+                  image[x,y+1]*(1-wx)*wy + image[x+1,y+1]*wx*wy */
+               *output++ = 
+                  (*(tmp) * (1-wx) + *nextcol(tmp, w, h) * wx) * (1-wy) +
+                  (*nextrow(tmp,w,h) * (1-wx) + *nextr_c(tmp,w,h) * wx) * wy;
+            } else 
+               *output++ = fill;
+         } else 
+            *output++ = fill;
+      }
+   }
+}
+
+/* one output column of an affine warp: source coordinates (x0,y0) + j*(dx,dy) for rows j */
+static void warp_column_affine(const unsigned char *image, int w, int h, double x0, double y0,
+                               double dx, double dy, int rows, float fill, float *out)
+{
+   int j = 0;
+#ifdef WARP_SSE2
+   const __m128 step = _mm_set_ps(3,2,1,0);
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 vfill = _mm_set1_ps(fill);
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i xlim = _mm_set1_epi32(w-1);
+   const __m128i ylim = _mm_set1_epi32(h-1);
+   const __m128 vdx = _mm_set1_ps((float)dx), vdy = _mm_set1_ps((float)dy);
+   int ix[4], iy[4], valid[4];
+   float p00[4], p01[4], p10[4], p11[4];
+   for (; j+4 <= rows; j += 4)
+   {
+      /* coordinates of rows j..j+3, anchored in double every 4 rows so float errors do not accumulate */
+      __m128 fx = _mm_add_ps(_mm_set1_ps((float)(x0+j*dx)),_mm_mul_ps(step,vdx));
+      __m128 fy = _mm_add_ps(_mm_set1_ps((float)(y0+j*dy)),_mm_mul_ps(step,vdy));
+      /* floor: truncate, then correct the negative ones */
+      __m128i tx = _mm_cvttps_epi32(fx);
+      __m128i ty = _mm_cvttps_epi32(fy);
+      tx = _mm_add_epi32(tx,_mm_castps_si128(_mm_cmplt_ps(fx,_mm_cvtepi32_ps(tx))));
+      ty = _mm_add_epi32(ty,_mm_castps_si128(_mm_cmplt_ps(fy,_mm_cvtepi32_ps(ty))));
+      __m128 ax = _mm_sub_ps(fx,_mm_cvtepi32_ps(tx));
+      __m128 ay = _mm_sub_ps(fy,_mm_cvtepi32_ps(ty));
+      /* 0 <= x < w-1 and 0 <= y < h-1 */
+      __m128i in = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(tx,_mm_sub_epi32(zero,_mm_set1_epi32(1))),_mm_cmplt_epi32(tx,xlim)),
+                                 _mm_and_si128(_mm_cmpgt_epi32(ty,_mm_sub_epi32(zero,_mm_set1_epi32(1))),_mm_cmplt_epi32(ty,ylim)));
+      _mm_storeu_si128((__m128i*)ix,tx);
+      _mm_storeu_si128((__m128i*)iy,ty);
+      _mm_storeu_si128((__m128i*)valid,in);
+      for (int k = 0; k < 4; k++)
+      {
+         if (valid[k])
+         {
+            const unsigned char *tmp = &image[coord(ix[k],iy[k],w,h)];
+            p00[k] = *tmp;
+            p01[k] = *nextcol(tmp,w,h);
+            p10[k] = *nextrow(tmp,w,h);
+            p11[k] = *nextr_c(tmp,w,h);
+         } else
+            p00[k] = p01[k] = p10[k] = p11[k] = 0;
+      }
+      __m128 bx = _mm_sub_ps(one,ax);
+      __m128 top = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(p00),bx),_mm_mul_ps(_mm_loadu_ps(p01),ax));
+      __m128 bot = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(p10),bx),_mm_mul_ps(_mm_loadu_ps(p11),ax));
+      __m128 r = _mm_add_ps(_mm_mul_ps(top,_mm_sub_ps(one,ay)),_mm_mul_ps(bot,ay));
+      __m128 m = _mm_castsi128_ps(in);
+      _mm_storeu_ps(out+j,_mm_or_ps(_mm_and_ps(m,r),_mm_andnot_ps(m,vfill)));
+   }
+#endif
+   for (; j < rows; j++)
+   {
+      float wx = (float)(x0+j*dx), wy = (float)(y0+j*dy);
+      int x = (int)floorf(wx);
+      int y = (int)floorf(wy);
+      if (x>=0 && y>=0 && (x+1)<w && (y+1)<h)
+      {
+         wx -= x; wy -= y;
+         const unsigned char *tmp = &image[coord(x,y,w,h)];
+         out[j] = (*(tmp) * (1-wx) + *nextcol(tmp, w, h) * wx) * (1-wy) +
+                  (*nextrow(tmp,w,h) * (1-wx) + *nextr_c(tmp,w,h) * wx) * wy;
+      } else
+         out[j] = fill;
+   }
+}
+
+void warp_image_roi_batch(const unsigned char *image, int w, int h, const double *H, int K,
+                          double xmin, double xmax, double ymin, double ymax,
+                          float fill, float *result)
+{
+   int cols = (int)(xmax-xmin+1);
+   int rows = (int)(ymax-ymin+1);
+   if (cols <= 0 || rows <= 0) return;
+
+   for (int k = 0; k < K; k++, H += 9)
+   {
+      float *patch = result + (size_t)k*rows*cols;
+      bool affine = M(2,0)==0 && M(2,1)==0 && M(2,2)==1;
+      for (int i = 0; i < cols; i++)
+      {
+         double xx = xmin + i;
+         float *out = patch + (size_t)i*rows;
+         if (affine)
+         {
+            /* source of (xx,ymin) and its increment along the column */
+            double x0 = M(0,0)*xx + M(0,1)*ymin + M(0,2);
+            double y0 = M(1,0)*xx + M(1,1)*ymin + M(1,2);
+            warp_column_affine(image,w,h,x0,y0,M(0,1),M(1,1),rows,fill,out);
+            continue;
+         }
+         for (int j = 0; j < rows; j++)
+         {
+            double yy = ymin + j;
+            double wz = M(2,0)*xx + M(2,1)*yy + M(2,2);
+            double wx = (M(0,0)*xx + M(0,1)*yy + M(0,2)) / wz;
+            double wy = (M(1,0)*xx + M(1,1)*yy + M(1,2)) / wz;
+            int x = (int)floor(wx);
+            int y = (int)floor(wy);
+            if (x>=0 && y>=0 && (x+1)<w && (y+1)<h)
+            {
+               wx -= x; wy -= y;
+               const unsigned char *tmp = &image[coord(x,y,w,h)];
+               out[j] = (float)((*(tmp) * (1-wx) + *nextcol(tmp, w, h) * wx) * (1-wy) +
+                                (*nextrow(tmp,w,h) * (1-wx) + *nextr_c(tmp,w,h) * wx) * wy);
+            } else
+               out[j] = fill;
+         }
+      }
+   }
+}
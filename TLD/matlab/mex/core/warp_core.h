@@ -0,0 +1,35 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+// Affine/projective warp of an image region, free of MATLAB.
+
+#pragma once
+
+/* Warps image of size w x h (column-major), using the 3x3 transformation matrix H
+   (column-major, maps output to input coordinates). Result is the region
+   [xmin,xmax] x [ymin,ymax] stored row by row; pixels mapped outside the image get fill. */
+void warp_image_roi(const unsigned char *image, int w, int h, const double *H,
+                    double xmin, double xmax, double ymin, double ymax,
+                    double fill, double *result);
+
+/* Warps the same region with K matrices H (3x3xK) in single precision. Patch k is stored
+   column-major (MATLAB layout) at result + k*rows*cols, rows = ymax-ymin+1, cols = xmax-xmin+1.
+   Affine matrices are interpolated along each output column from incremental source
+   coordinates, 4 rows at a time; projective ones fall back to a per-pixel division. */
+void warp_image_roi_batch(const unsigned char *image, int w, int h, const double *H, int K,
+                          double xmin, double xmax, double ymin, double ymax,
+                          float fill, float *result);
@@ -0,0 +1,102 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "worker_pool.h"
+using namespace std;
+
+int WorkerPool::hardwareThreads() {
+	int n = (int) thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+WorkerPool::WorkerPool(int nThreads) : job(0), nJobChunks(0), nextChunk(0), busy(0), generation(0), stop(false) {
+	if (nThreads <= 0) nThreads = hardwareThreads();
+	for (int i = 1; i < nThreads; i++) {
+		workers.push_back(thread(&WorkerPool::loop,this));
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		lock_guard<mutex> lock(mtx);
+		stop = true;
+	}
+	start.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+// Claims chunks until none are left
+void WorkerPool::work(const function<void(int)> &task, int nChunks) {
+	while (1) {
+		int chunk;
+		{
+			lock_guard<mutex> lock(mtx);
+			if (nextChunk >= nChunks) return;
+			chunk = nextChunk++;
+		}
+		task(chunk);
+	}
+}
+
+void WorkerPool::loop() {
+	unsigned seen = 0;
+	while (1) {
+		const function<void(int)> *task;
+		int nChunks;
+		{
+			unique_lock<mutex> lock(mtx);
+			while (!stop && generation == seen) start.wait(lock);
+			if (stop) return;
+			seen = generation;
+			task = job;
+			if (task == 0) continue; // woke up after the job was done
+			nChunks = nJobChunks;
+			busy++;
+		}
+		work(*task,nChunks);
+		{
+			lock_guard<mutex> lock(mtx);
+			busy--;
+		}
+		finished.notify_one();
+	}
+}
+
+void WorkerPool::run(int nChunks, const function<void(int)> &task) {
+	if (nChunks <= 0) return;
+	if (workers.empty() || nChunks == 1) {
+		for (int i = 0; i < nChunks; i++) task(i);
+		return;
+	}
+	{
+		lock_guard<mutex> lock(mtx);
+		job = &task;
+		nJobChunks = nChunks;
+		nextChunk = 0;
+		generation++;
+	}
+	start.notify_all();
+	work(task,nChunks);
+
+	// wait for the workers still processing their last chunk
+	unique_lock<mutex> lock(mtx);
+	while (busy > 0) finished.wait(lock);
+	job = 0;
+}
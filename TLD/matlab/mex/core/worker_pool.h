@@ -0,0 +1,57 @@
+// Copyright 2011 Zdenek Kalal
+//
+// This file is part of TLD.
+// 
+// TLD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// TLD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with TLD.  If not, see <http://www.gnu.org/licenses/>.
+
+// Fixed set of worker threads for data-parallel loops of the kernels.
+// Tasks only get chunk indexes; they must not call the MATLAB API.
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class WorkerPool {
+public:
+	// nThreads includes the calling thread; 0 = one per hardware thread
+	explicit WorkerPool(int nThreads);
+	~WorkerPool();
+	int size() const { return (int) workers.size() + 1; }
+
+	// Calls task(chunk) for every chunk in [0,nChunks) on all threads, returns when all are done
+	void run(int nChunks, const std::function<void(int)> &task);
+
+	static int hardwareThreads();
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable start;
+	std::condition_variable finished;
+	const std::function<void(int)> *job;
+	int nJobChunks;
+	int nextChunk;
+	int busy;
+	unsigned generation;
+	bool stop;
+
+	void loop();
+	void work(const std::function<void(int)> &task, int nChunks);
+
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+};
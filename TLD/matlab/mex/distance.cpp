@@ -15,44 +15,10 @@
 // You should have received a copy of the GNU General Public License
 // along with TLD.  If not, see <http://www.gnu.org/licenses/>.
 
+
 #include <stdio.h>
 #include "mex.h"
-#include "math.h"
-
-// correlation
-double ccorr(double *f1,double *f2,int numDim) {
-	double f = 0;
-	for (int i = 0; i<numDim; i++) {
-		f += f1[i]*f2[i];
-	}
-	return f;
-}
-
-// correlation normalized
-double ccorr_normed(double *f1,double *f2,int numDim) {
-	double corr = 0;
-	double norm1 = 0;
-	double norm2 = 0;
-
-	for (int i = 0; i<numDim; i++) {
-		corr += f1[i]*f2[i];
-		norm1 += f1[i]*f1[i];
-		norm2 += f2[i]*f2[i];
-	}
-	// normalization to <0,1>
-	return (corr / sqrt(norm1*norm2) + 1) / 2.0;
-}
-
-// euclidean distance
-double euclidean(double *f1,double *f2,int numDim) {
-
-	double sum = 0;
-	for (int i = 0; i<numDim; i++) {
-		sum += (f1[i]-f2[i])*(f1[i]-f2[i]);
-	}
-	return sqrt(sum);
-}
-
+#include "core/distance_core.h"
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
@@ -73,28 +39,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	}
 
 	plhs[0] = mxCreateDoubleMatrix(N1, N2, mxREAL);
-	double *resp = mxGetPr(plhs[0]);
 
 	int flag = *mxGetPr(prhs[2]);
-
-	switch (flag)
-	{
-	case 1 :
-		for (int i = 0; i < N2; i++) {
-			for (int ii = 0; ii < N1; ii++) {
-				*resp++ = ccorr_normed(x1+ii*M1,x2+i*M1,M1);
-			}
-		}
-
-		return;
-	case 2 :
-
-		for (int i = 0; i < N2; i++) {
-			for (int ii = 0; ii < N1; ii++) {
-				*resp++ = euclidean(x1+ii*M1,x2+i*M1,M1);
-			}
-		}
-
-		return;
-	}
+	distance(x1,N1,x2,N2,M1,flag,mxGetPr(plhs[0]));
 }
@@ -15,7 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with TLD.  If not, see <http://www.gnu.org/licenses/>.
 
-void iimg(unsigned char *in, double *ii, int imH, int imW) {
+void iimg(const unsigned char *in, double *ii, int imH, int imW) {
 
 	double *prev_line = ii;
 	double s;
@@ -38,7 +38,7 @@ void iimg(unsigned char *in, double *ii, int imH, int imW) {
 }
 
 
-void iimg2(unsigned char *in, double *ii2, int imH, int imW) {
+void iimg2(const unsigned char *in, double *ii2, int imH, int imW) {
 
 	double *prev_line = ii2;
 	double s;
@@ -62,7 +62,7 @@ void iimg2(unsigned char *in, double *ii2, int imH, int imW) {
 }
 
 
-double bbox_var_offset(double *ii,double *ii2, int *off) {
+double bbox_var_offset(const double *ii,const double *ii2, const int *off) {
 	// off[0-3] corners of bbox, off[4] area
 	double mX  = (ii[off[3]] - ii[off[2]] - ii[off[1]] + ii[off[0]]) / (double) off[4];
 	double mX2 = (ii2[off[3]] - ii2[off[2]] - ii2[off[1]] + ii2[off[0]]) / (double) off[4];
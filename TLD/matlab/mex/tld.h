@@ -15,6 +15,6 @@
 // You should have received a copy of the GNU General Public License
 // along with TLD.  If not, see <http://www.gnu.org/licenses/>.
 
-void iimg(unsigned char *in, double *ii, int imH, int imW);
-void iimg2(unsigned char *in, double *ii2, int imH, int imW);
-double bbox_var_offset(double *ii,double *ii2, int *off);
+void iimg(const unsigned char *in, double *ii, int imH, int imW);
+void iimg2(const unsigned char *in, double *ii2, int imH, int imW);
+double bbox_var_offset(const double *ii,const double *ii2, const int *off);
@@ -17,83 +17,7 @@
 
 #include "mex.h"
 #include <math.h>
-
-#ifndef NAN
-#define NAN 0/0
-#endif
-
-#ifndef M_PI
-#define M_PI 3.14159265358979L
-#endif
-// rowwise access
-#define coord(x, y, width, height) (y+x*height)
-#define nextrow(tmp, width, height) ((tmp)+1)
-#define nextcol(tmp, width, height) ((tmp)+height)
-#define nextr_c(tmp, width, height) ((tmp)+height+1)
-
-#define M(r, c) H[c*3+r]
-
-/* Warps image of size w x h, using affine transformation matrix (2x2 part) 
-   and offset (center of warping) ofsx, ofsy. Result is the region of size 
-   defined with roi. */
-void warp_image_roi(unsigned char *image, int w, int h, double *H,
-                    double xmin, double xmax, double ymin, double ymax,
-                    double fill, double *result)
-{
-   double curx, cury, curz, wx, wy, wz, ox, oy, oz;
-   int x, y;
-   unsigned char *tmp;
-   double *output=result, i, j, xx, yy;
-   /* precalulate necessary constant with respect to i,j offset 
-      translation, H is column oriented (transposed) */   
-   ox = M(0,2);
-   oy = M(1,2);
-   oz = M(2,2);
-
-   yy = ymin;
-   for (j=0; j<(int)(ymax-ymin+1); j++)
-   {
-      /* calculate x, y for current row */
-      curx = M(0,1)*yy + ox;
-      cury = M(1,1)*yy + oy;
-      curz = M(2,1)*yy + oz;
-      xx = xmin; 
-      yy = yy + 1;
-      for (i=0; i<(int)(xmax-xmin+1); i++)
-      {
-         /* calculate x, y in current column */
-         wx = M(0,0)*xx + curx;
-         wy = M(1,0)*xx + cury;
-         wz = M(2,0)*xx + curz;
-//       printf("%g %g, %g %g %g\n", xx, yy, wx, wy, wz);
-         wx /= wz; wy /= wz;
-         xx = xx + 1;
-         
-         x = (int)floor(wx);
-         y = (int)floor(wy);
-
-         if (x>=0 && y>=0)
-         {
-            wx -= x; wy -= y; 
-            if (x+1==w && wx==1)
-               x--;
-            if (y+1==h && wy==1)
-               y--;
-            if ((x+1)<w && (y+1)<h)
-            {
-               tmp = &image[coord(x,y,w,h)];
-               /* image[x,y]*(1-wx)*(1-wy) + image[x+1,y]*wx*(1-wy) +
-                  image[x,y+1]*(1-wx)*wy + image[x+1,y+1]*wx*wy */
-               *output++ = 
-                  (*(tmp) * (1-wx) + *nextcol(tmp, w, h) * wx) * (1-wy) +
-                  (*nextrow(tmp,w,h) * (1-wx) + *nextr_c(tmp,w,h) * wx) * wy;
-            } else 
-               *output++ = fill;
-         } else 
-            *output++ = fill;
-      }
-   }
-}
+#include "core/warp_core.h"
 
 mxArray *to_matlab(const double *image, int num_cols, int num_rows)
 {
@@ -143,6 +67,20 @@ void mexFunction (int nlhs, mxArray *plhs [], int nrhs, const mxArray *prhs [])
          fill=0;
       else
          fill=0;
+
+      /* warp(img,H,box) with H 3x3xK: all K patches in one single precision rows x cols x K array */
+      if (nrhs>1 && mxGetNumberOfDimensions(prhs[1])==3)
+      {
+         const mwSize *hdims = mxGetDimensions(prhs[1]);
+         mwSize dims[3];
+         dims[0] = (int)(ymax-ymin+1);
+         dims[1] = (int)(xmax-xmin+1);
+         dims[2] = hdims[2];
+         plhs[0] = mxCreateNumericArray(3, dims, mxSINGLE_CLASS, mxREAL);
+         warp_image_roi_batch(im, w, h, H, (int) hdims[2], xmin, xmax, ymin, ymax, (float) fill, (float *) mxGetData(plhs[0]));
+         return;
+      }
+
       result=new double[((int)(xmax-xmin+1)*(int)(ymax-ymin+1))];
       {
          warp_image_roi(im, w, h, H, xmin, xmax, ymin, ymax, fill, result);
@@ -43,13 +43,21 @@ pEx = tldGetPattern(im1,bbP0,tld.model.patchsize);
 if tld.model.fliplr
 pEx = [pEx tldGetPattern(im1,bbP0,tld.model.patchsize,1)];
 end
+% Synthetic warps of the hull, all warped by a single call (same random sequence as img_patch)
+nWarps = p_par.num_warps-1;
+if nWarps > 0
+    Hinv  = zeros(3,3,nWarps);
+    noise = zeros(length(rows),length(cols),nWarps);
+    for i = 1:nWarps
+        randomize = rand; % Sets the internal randomizer to the same state
+        [Hinv(:,:,i),box,noise(:,:,i)] = img_warp_params(bbH,randomize,p_par);
+    end
+    patches = warp(im0.blur,Hinv,box);
+end
+
 for i = 1:p_par.num_warps
     if i > 1
-        randomize = rand; % Sets the internal randomizer to the same state
-        %patch_input = img_patch(im0.input,bbH,randomize,p_par);
-        patch_blur = img_patch(im0.blur,bbH,randomize,p_par);
-        im1.blur(rows,cols) = patch_blur;
-        %im1.input(rows,cols) = patch_input;
+        im1.blur(rows,cols) = uint8(double(patches(:,:,i-1)) + noise(:,:,i-1));
     end
     
     % Measures on blured image
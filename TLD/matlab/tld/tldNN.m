@@ -37,10 +37,13 @@ end
 conf1 = nan(1,size(x,2));
 conf2 = nan(1,size(x,2));
 
+NCCP = distance(x,tld.pex,1); % measure NCC of all patches to positive examples (one row per patch)
+NCCN = distance(x,tld.nex,1); % measure NCC of all patches to negative examples
+
 for i = 1:size(x,2) % fore every patch that is tested
     
-    nccP = distance(x(:,i),tld.pex,1); % measure NCC to positive examples
-    nccN = distance(x(:,i),tld.nex,1); % measure NCC to negative examples
+    nccP = NCCP(i,:);
+    nccN = NCCN(i,:);
     
     % set isin
     if any(nccP > tld.model.ncc_thesame), isin(1,i) = 1;  end % IF the query patch is highly correlated with any positive patch in the model THEN it is considered to be one of them